@@ -1,18 +1,106 @@
 #include <stack>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <coroutine>
+#include <algorithm>
+#include <vector>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <chrono>
+#include <iostream>
 #include <memory>
+#include <new>
+#include <cstdlib>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <deque>
 #include <utility>
 #include <stdexcept>
+#include <exception>
+#include <system_error>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#ifndef CUSTOMIZED_QUEUE_INSTRUMENTATION
+#define CUSTOMIZED_QUEUE_INSTRUMENTATION false
+#endif
+
 namespace
 {
+    // How CustomizedQueue stores its elements inside its stacks
+    enum class StoragePolicy
+    {
+        // One heap allocation per element, elements never move once emplaced
+        Indirect,
+        // Elements stored inline in contiguous blocks, moved once from the
+        // writing stack to the reading stack
+        Inline
+    };
+
     /* Customized queue using only stack data structure by
-       reversing elements order when pop() or front() */
-    template <typename T>
+       reversing elements order when pop() or front().
+       Elements are only transferred into the reading stack when it
+       is empty, so each element is transferred once (amortized O(1)).
+       Stacks blocks and indirect elements are allocated with Allocator,
+       see pmr::CustomizedQueue to allocate from a memory resource */
+    template <typename T,
+              StoragePolicy Policy = StoragePolicy::Indirect,
+              typename Allocator = std::allocator<T>>
     class CustomizedQueue
     {
+        template <typename U>
+        using Rebind_t = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+        using ElementAllocatorTraits_t = std::allocator_traits<Rebind_t<T>>;
+
+        struct ElementDeleter
+        {
+            [[no_unique_address]] Rebind_t<T> allocator;
+
+            void operator()(T *element)
+            {
+                ElementAllocatorTraits_t::destroy(allocator, element);
+                ElementAllocatorTraits_t::deallocate(allocator, element, 1);
+            }
+        };
+
+        using Element_t = std::conditional_t<Policy == StoragePolicy::Inline,
+                                             T,
+                                             std::unique_ptr<T, ElementDeleter>>;
+        using Container_t = std::deque<Element_t, Rebind_t<Element_t>>;
+
+        // std::deque allocates its elements by contiguous blocks and never
+        // relocates them when growing. Its container is exposed to process
+        // whole runs of elements at once
+        struct Stack_t : std::stack<Element_t, Container_t>
+        {
+            using std::stack<Element_t, Container_t>::stack;
+            using std::stack<Element_t, Container_t>::c;
+        };
+
     public :
+        explicit CustomizedQueue(const Allocator& allocator = Allocator())
+            : _readingStack(Rebind_t<Element_t>(allocator)),
+              _writingStack(Rebind_t<Element_t>(allocator))
+        { }
+
+        [[nodiscard]]
+        inline Allocator get_allocator() const noexcept
+        {
+            return Allocator(_writingStack.c.get_allocator());
+        }
+
         [[nodiscard]]
         inline bool empty() const noexcept
         {
@@ -28,8 +116,89 @@ namespace
         template <typename... Args>
         void emplace(Args&&... args)
         {
-            _writingStack.emplace(std::make_unique<T>(std::forward<Args>(args)...));
-            _needSetReadingStack = true;
+            if constexpr (Policy == StoragePolicy::Inline)
+            {
+                _writingStack.emplace(std::forward<Args>(args)...);
+            }
+            else
+            {
+                _writingStack.emplace(makeElement(std::forward<Args>(args)...));
+            }
+        }
+
+        // Emplaces all elements of [first, last) in order
+        template <typename InputIt>
+        void emplace_range(InputIt first, InputIt last)
+        {
+            auto& container = _writingStack.c;
+
+            if constexpr (Policy == StoragePolicy::Inline)
+            {
+                container.insert(container.end(), first, last);
+            }
+            else
+            {
+                for (; first != last; ++first)
+                {
+                    container.emplace_back(makeElement(*first));
+                }
+            }
+        }
+
+        /* Moves up to n front elements into out, in order, and returns how
+           many were popped. The reading stack is consumed from its top and
+           then the writing stack from its bottom, without any transfer */
+        template <typename OutputIt>
+        size_t pop_n(OutputIt out, size_t n)
+        {
+            size_t popped = std::min(n, size());
+            auto& reading = _readingStack.c;
+            size_t fromReading = std::min(popped, reading.size());
+            auto readingEnd = reading.end() - fromReading;
+
+            for (auto it = reading.end(); it != readingEnd; )
+            {
+                *out++ = std::move(getValue(*--it));
+            }
+
+            reading.erase(readingEnd, reading.end());
+
+            auto& writing = _writingStack.c;
+            auto writingEnd = writing.begin() + (popped - fromReading);
+
+            for (auto it = writing.begin(); it != writingEnd; ++it)
+            {
+                *out++ = std::move(getValue(*it));
+            }
+
+            writing.erase(writing.begin(), writingEnd);
+
+            return popped;
+        }
+
+        // Calls func on every element in order then empties the queue,
+        // returns how many elements were drained
+        template <typename Func>
+        size_t drain(Func&& func)
+        {
+            size_t drained = size();
+            auto& reading = _readingStack.c;
+            auto& writing = _writingStack.c;
+
+            for (auto it = reading.rbegin(); it != reading.rend(); ++it)
+            {
+                func(getValue(*it));
+            }
+
+            for (auto& element : writing)
+            {
+                func(getValue(element));
+            }
+
+            reading.clear();
+            writing.clear();
+
+            return drained;
         }
 
         void pop()
@@ -39,7 +208,7 @@ namespace
                 throw std::runtime_error("stacks are empty");
             }
 
-            if (_needSetReadingStack)
+            if (_readingStack.empty())
             {
                 setReadingStack();
             }
@@ -55,12 +224,12 @@ namespace
                 throw std::runtime_error("stacks are empty");
             }
 
-            if (_needSetReadingStack)
+            if (_readingStack.empty())
             {
                 setReadingStack();
             }
 
-            return *_readingStack.top();
+            return getValue(_readingStack.top());
         }
 
         [[nodiscard]]
@@ -71,307 +240,1754 @@ namespace
                 throw std::runtime_error("stacks are empty");
             }
 
-            if (_needSetReadingStack)
+            if (_readingStack.empty())
             {
                 setReadingStack();
             }
 
-            return *_readingStack.top();
+            return getValue(_readingStack.top());
         }
 
     private :
-        mutable std::stack<std::unique_ptr<T>> _readingStack;
-        mutable std::stack<std::unique_ptr<T>> _writingStack;
-        mutable bool _needSetReadingStack = false;
+        mutable Stack_t _readingStack;
+        mutable Stack_t _writingStack;
 
-        void setReadingStack() const
+        template <typename... Args>
+        [[nodiscard]]
+        Element_t makeElement(Args&&... args)
         {
-            auto moveElementsInto = [](
-                std::stack<std::unique_ptr<T>>& stack,
-                std::stack<std::unique_ptr<T>>& stack2)
+            Rebind_t<T> allocator(_writingStack.c.get_allocator());
+            T *element = ElementAllocatorTraits_t::allocate(allocator, 1);
+
+            try
             {
-                while (!stack2.empty())
-                {
-                    auto& valuePtr = stack2.top();
+                ElementAllocatorTraits_t::construct(allocator, element,
+                                                    std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                ElementAllocatorTraits_t::deallocate(allocator, element, 1);
+                throw;
+            }
 
-                    stack.emplace(std::move(valuePtr));
-                    stack2.pop();
-                }
-            };
-            std::stack<std::unique_ptr<T>> newReadingStack;
-            std::stack<std::unique_ptr<T>> reversedReadingStack;
+            return Element_t(element, ElementDeleter{std::move(allocator)});
+        }
 
-            moveElementsInto(newReadingStack, _writingStack);
-            moveElementsInto(reversedReadingStack, _readingStack);
-            moveElementsInto(newReadingStack, reversedReadingStack);
-            _readingStack = std::move(newReadingStack);
-            _needSetReadingStack = false;
+        [[nodiscard]]
+        static inline T& getValue(Element_t& element) noexcept
+        {
+            if constexpr (Policy == StoragePolicy::Inline)
+            {
+                return element;
+            }
+            else
+            {
+                return *element;
+            }
         }
-    };
-}
 
-using testing::StrictMock;
+        // Only called when the reading stack is empty : reversing the whole
+        // writing stack into it puts the oldest element on top
+        void setReadingStack() const
+        {
+            while (!_writingStack.empty())
+            {
+                _readingStack.emplace(std::move(_writingStack.top()));
+                _writingStack.pop();
+            }
+        }
+    };
 
-TEST(CustomizedQueue, Test_1)
-{
-    CustomizedQueue<int> cq;
+    /* CustomizedQueue shared between threads whose consumers can wait for
+       elements : a waiting consumer first spins a few times on an atomic
+       size, then parks on a condition variable (a futex on Linux).
+       Producers only notify when a consumer is actually parked */
+    template <typename T,
+              StoragePolicy Policy = StoragePolicy::Indirect,
+              typename Allocator = std::allocator<T>>
+    class BlockingCustomizedQueue
+    {
+    public :
+        explicit BlockingCustomizedQueue(const Allocator& allocator = Allocator())
+            : _queue(allocator)
+        { }
 
-    ASSERT_TRUE(cq.empty());
-    ASSERT_EQ(cq.size(), 0);
+        [[nodiscard]]
+        inline bool empty() const noexcept { return size() == 0; }
 
-    cq.emplace(1);
-    cq.emplace(2);
-    cq.emplace(3);
-    cq.emplace(4);
+        [[nodiscard]]
+        inline size_t size() const noexcept
+        {
+            return _size.load(std::memory_order_acquire);
+        }
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 4);
-    EXPECT_EQ(cq.front(), 1);
+        [[nodiscard]]
+        inline bool closed() const noexcept
+        {
+            return _closed.load(std::memory_order_acquire);
+        }
 
-    cq.pop();
+        template <typename... Args>
+        void emplace(Args&&... args)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 3);
-    EXPECT_EQ(cq.front(), 2);
+                if (closed())
+                {
+                    throw std::runtime_error("queue is closed");
+                }
 
-    cq.pop();
+                _queue.emplace(std::forward<Args>(args)...);
+                _size.store(_queue.size(), std::memory_order_release);
+            }
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 2);
-    EXPECT_EQ(cq.front(), 3);
+            if (_nbParkedConsumers.load() > 0)
+            {
+                _condVar.notify_one();
+            }
+        }
 
-    cq.pop();
+        // Wakes up all waiting consumers, remaining elements can still be popped
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 1);
-    EXPECT_EQ(cq.front(), 4);
+                _closed.store(true, std::memory_order_release);
+            }
 
-    cq.pop();
+            _condVar.notify_all();
+        }
 
-    ASSERT_TRUE(cq.empty());
-    ASSERT_EQ(cq.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
-                 std::runtime_error);
-    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+        // Returns std::nullopt if the queue is empty
+        [[nodiscard]]
+        std::optional<T> try_pop()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
 
-    const auto& cq2 = cq;
+            return popLocked();
+        }
 
-    ASSERT_TRUE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] const auto& _ = cq2.front(); },
-                 std::runtime_error);
-}
+        // Returns std::nullopt only once the queue is closed and empty
+        [[nodiscard]]
+        std::optional<T> wait_pop()
+        {
+            spin();
 
-TEST(CustomizedQueue, Test_2)
-{
-    CustomizedQueue<int> cq;
+            std::unique_lock<std::mutex> lock(_mutex);
 
-    ASSERT_TRUE(cq.empty());
-    ASSERT_EQ(cq.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
-                 std::runtime_error);
-    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+            // Registered as parked under the lock so emplace() can't miss us
+            ++_nbParkedConsumers;
+            _condVar.wait(lock, [this]() { return isReady(); });
+            --_nbParkedConsumers;
 
-    cq.emplace(1);
+            return popLocked();
+        }
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 1);
-    EXPECT_EQ(cq.front(), 1);
+        // Returns std::nullopt on timeout or once the queue is closed and empty
+        template <typename Rep, typename Period>
+        [[nodiscard]]
+        std::optional<T> wait_pop_for(const std::chrono::duration<Rep, Period>& timeout)
+        {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
 
-    cq.pop();
+            spin();
 
-    ASSERT_TRUE(cq.empty());
-    ASSERT_EQ(cq.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
-                 std::runtime_error);
-    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+            std::unique_lock<std::mutex> lock(_mutex);
 
-    cq.emplace(2);
-    cq.emplace(3);
+            ++_nbParkedConsumers;
+            _condVar.wait_until(lock, deadline, [this]() { return isReady(); });
+            --_nbParkedConsumers;
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 2);
-    EXPECT_EQ(cq.front(), 2);
+            return popLocked();
+        }
 
-    cq.pop();
+    private :
+        static constexpr uint32_t SPIN_ITERATIONS = 64;
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 1);
-    EXPECT_EQ(cq.front(), 3);
+        std::mutex _mutex;
+        std::condition_variable _condVar;
+        CustomizedQueue<T, Policy, Allocator> _queue;
+        std::atomic<size_t> _size = 0;
+        std::atomic<bool> _closed = false;
+        std::atomic<uint32_t> _nbParkedConsumers = 0;
 
-    cq.emplace(4);
-    cq.emplace(5);
-    cq.emplace(6);
+        [[nodiscard]]
+        inline bool isReady() const noexcept { return !empty() || closed(); }
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 4);
-    EXPECT_EQ(cq.front(), 3);
+        void spin() const
+        {
+            for (uint32_t n = 0; n < SPIN_ITERATIONS && !isReady(); ++n)
+            {
+                std::this_thread::yield();
+            }
+        }
 
-    const auto& cq2 = cq;
+        [[nodiscard]]
+        std::optional<T> popLocked()
+        {
+            if (_queue.empty())
+            {
+                return std::nullopt;
+            }
 
-    cq.pop();
+            std::optional<T> value(std::move(_queue.front()));
 
-    ASSERT_FALSE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 3);
-    EXPECT_EQ(cq2.front(), 4);
+            _queue.pop();
+            _size.store(_queue.size(), std::memory_order_release);
 
-    cq.pop();
+            return value;
+        }
+    };
 
-    ASSERT_FALSE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 2);
-    EXPECT_EQ(cq2.front(), 5);
+    /* Append-only file segment, mapped in memory, holding trivially copyable
+       elements in FIFO order. Once the read elements take half of the
+       mapping, the unread ones are moved back to its start, so the file only
+       grows with the elements spilled at the same time. The file is unlinked
+       as soon as created so the system reclaims it when the segment is
+       destroyed */
+    template <typename T>
+    class SpillSegment
+    {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "spilled elements are copied byte per byte");
 
-    cq.pop();
+    public :
+        explicit SpillSegment(const std::filesystem::path& directory)
+        {
+            std::string path = (directory / "CustomizedQueue.spill.XXXXXX").string();
 
-    ASSERT_FALSE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 1);
-    EXPECT_EQ(cq2.front(), 6);
+            _fd = ::mkstemp(path.data());
 
-    cq.pop();
+            if (_fd == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), "mkstemp");
+            }
 
-    ASSERT_TRUE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] const auto& _ = cq2.front(); },
-                 std::runtime_error);
-}
+            ::unlink(path.c_str());
+        }
 
-class Mock
-{
-public :
-    MOCK_METHOD(void, onCopyConstructor, (), (const, noexcept));
-    MOCK_METHOD(void, onMoveConstructor, (), (const, noexcept));
-    MOCK_METHOD(void, onCopyAssignment, (), (const, noexcept));
-    MOCK_METHOD(void, onMoveAssignment, (), (const, noexcept));
-};
+        SpillSegment(const SpillSegment&) = delete;
+        SpillSegment& operator=(const SpillSegment&) = delete;
 
-class TestObject
-{
-public :
-    static StrictMock<Mock> *_mockPtr;
+        ~SpillSegment()
+        {
+            if (_mapping)
+            {
+                ::munmap(_mapping, _mappingSize);
+            }
 
-    TestObject(int value) noexcept : _value(value) { }
+            ::close(_fd);
+        }
 
-    TestObject(const TestObject&)
-    {
-        if (_mockPtr)
+        [[nodiscard]]
+        inline size_t size() const noexcept
         {
-            _mockPtr->onCopyConstructor();
+            return (_writeOffset - _readOffset) / sizeof(T);
         }
-    }
 
-    TestObject(TestObject&&)
-    {
-        if (_mockPtr)
+        // Bytes of the file mapped in memory
+        [[nodiscard]]
+        inline size_t capacity() const noexcept { return _mappingSize; }
+
+        // Appending n elements never remaps the segment more than once
+        void reserve(size_t n)
         {
-            _mockPtr->onMoveConstructor();
-        }
-    }
+            size_t requiredSize = _writeOffset + n * sizeof(T);
 
-    TestObject& operator=(const TestObject&)
-    {
+            if (requiredSize <= _mappingSize)
+            {
+                return;
+            }
+
+            size_t newSize = std::max(_mappingSize, MIN_MAPPING_SIZE);
+
+            while (newSize < requiredSize)
+            {
+                newSize *= 2;
+            }
+
+            if (::ftruncate(_fd, static_cast<off_t>(newSize)) == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), "ftruncate");
+            }
+
+            if (_mapping)
+            {
+                ::munmap(_mapping, _mappingSize);
+                _mapping = nullptr;
+            }
+
+            void *mapping = ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, _fd, 0);
+
+            if (mapping == MAP_FAILED)
+            {
+                throw std::system_error(errno, std::generic_category(), "mmap");
+            }
+
+            _mapping = static_cast<std::byte *>(mapping);
+            _mappingSize = newSize;
+        }
+
+        void push(const T& value)
+        {
+            reserve(1);
+            std::memcpy(_mapping + _writeOffset, &value, sizeof(T));
+            _writeOffset += sizeof(T);
+        }
+
+        [[nodiscard]]
+        T pop()
+        {
+            if (size() == 0)
+            {
+                throw std::runtime_error("spill segment is empty");
+            }
+
+            // T doesn't have to be default constructible
+            std::array<std::byte, sizeof(T)> bytes;
+
+            std::memcpy(bytes.data(), _mapping + _readOffset, sizeof(T));
+            _readOffset += sizeof(T);
+
+            // Moves at most as many bytes as read since the last compaction,
+            // nothing when fully read back
+            if (_readOffset == _writeOffset || _readOffset >= _mappingSize / 2)
+            {
+                std::memmove(_mapping, _mapping + _readOffset, _writeOffset - _readOffset);
+                _writeOffset -= _readOffset;
+                _readOffset = 0;
+            }
+
+            return std::bit_cast<T>(bytes);
+        }
+
+    private :
+        static constexpr size_t MIN_MAPPING_SIZE = 1 << 20;
+
+        int _fd = -1;
+        std::byte *_mapping = nullptr;
+        size_t _mappingSize = 0;
+        size_t _readOffset = 0;
+        size_t _writeOffset = 0;
+    };
+
+    /* CustomizedQueue with a bounded memory footprint : the front of the
+       queue stays in an in-memory head and the last emplaced elements in an
+       in-memory tail. When the tail is full, it is spilled to a file segment
+       holding the middle of the queue, which is read back in order when the
+       head runs out of elements */
+    template <typename T>
+    class SpillingCustomizedQueue
+    {
+    public :
+        SpillingCustomizedQueue(
+            size_t headCapacity,
+            size_t tailCapacity,
+            const std::filesystem::path& spillDirectory = std::filesystem::temp_directory_path())
+            : _headCapacity(std::max<size_t>(headCapacity, 1)),
+              _tailCapacity(std::max<size_t>(tailCapacity, 1)),
+              _spillSegment(spillDirectory)
+        { }
+
+        [[nodiscard]]
+        inline bool empty() const noexcept { return size() == 0; }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept
+        {
+            return _head.size() + _spillSegment.size() + _tail.size();
+        }
+
+        // Elements currently on disk
+        [[nodiscard]]
+        inline size_t spilledSize() const noexcept { return _spillSegment.size(); }
+
+        // Bytes of the spill file mapped in memory
+        [[nodiscard]]
+        inline size_t spillCapacity() const noexcept { return _spillSegment.capacity(); }
+
+        template <typename... Args>
+        void emplace(Args&&... args)
+        {
+            // Elements go to the head as long as nothing is queued behind it
+            if (_tail.empty() && _spillSegment.size() == 0 && _head.size() < _headCapacity)
+            {
+                _head.emplace(std::forward<Args>(args)...);
+
+                return;
+            }
+
+            if (_tail.size() == _tailCapacity)
+            {
+                _spillSegment.reserve(_tail.size());
+                _tail.drain([this](const T& value) { _spillSegment.push(value); });
+            }
+
+            _tail.emplace(std::forward<Args>(args)...);
+        }
+
+        void pop()
+        {
+            refillHead();
+            _head.pop();
+        }
+
+        [[nodiscard]]
+        const T& front() const
+        {
+            refillHead();
+
+            return _head.front();
+        }
+
+        [[nodiscard]]
+        T& front()
+        {
+            refillHead();
+
+            return _head.front();
+        }
+
+    private :
+        const size_t _headCapacity;
+        const size_t _tailCapacity;
+        mutable CustomizedQueue<T, StoragePolicy::Inline> _head;
+        mutable SpillSegment<T> _spillSegment;
+        mutable CustomizedQueue<T, StoragePolicy::Inline> _tail;
+
+        // Spilled elements are older than the tail ones, so they come first
+        void refillHead() const
+        {
+            if (!_head.empty())
+            {
+                return;
+            }
+
+            if (_spillSegment.size() > 0)
+            {
+                for (size_t n = std::min(_headCapacity, _spillSegment.size()); n > 0; --n)
+                {
+                    _head.emplace(_spillSegment.pop());
+                }
+            }
+            else
+            {
+                std::swap(_head, _tail);
+            }
+        }
+    };
+
+    // Resumes scheduled coroutines in FIFO order from the thread calling run()
+    class SingleThreadedExecutor
+    {
+    public :
+        inline void schedule(std::coroutine_handle<> handle) { _ready.emplace(handle); }
+
+        // Returns once no coroutine is ready to run anymore
+        void run()
+        {
+            while (!_ready.empty())
+            {
+                auto handle = _ready.front();
+
+                _ready.pop();
+                handle.resume();
+            }
+        }
+
+    private :
+        CustomizedQueue<std::coroutine_handle<>, StoragePolicy::Inline> _ready;
+    };
+
+    /* CustomizedQueue whose consumers are coroutines : co_await pop()
+       suspends the coroutine while the queue is empty instead of blocking
+       a thread. emplace() hands the element straight to the oldest waiting
+       consumer and schedules it on the executor, so consumers are served
+       in order and none can steal an element meant for another one.
+       Not thread-safe, the queue and its executor belong to one thread */
+    template <typename T, StoragePolicy Policy = StoragePolicy::Indirect>
+    class AwaitableCustomizedQueue
+    {
+    public :
+        class PopAwaiter
+        {
+        public :
+            explicit PopAwaiter(AwaitableCustomizedQueue& queue) noexcept
+                : _queue(queue)
+            { }
+
+            [[nodiscard]]
+            bool await_ready()
+            {
+                if (_queue._queue.empty())
+                {
+                    return false;
+                }
+
+                _value.emplace(std::move(_queue._queue.front()));
+                _queue._queue.pop();
+
+                return true;
+            }
+
+            // The awaiter lives in the suspended coroutine frame,
+            // so its address stays valid until it is resumed
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                _handle = handle;
+                _queue._waitingConsumers.emplace(this);
+            }
+
+            [[nodiscard]]
+            T await_resume() { return std::move(*_value); }
+
+        private :
+            friend AwaitableCustomizedQueue;
+
+            AwaitableCustomizedQueue& _queue;
+            std::optional<T> _value;
+            std::coroutine_handle<> _handle;
+        };
+
+        explicit AwaitableCustomizedQueue(SingleThreadedExecutor& executor) noexcept
+            : _executor(executor)
+        { }
+
+        [[nodiscard]]
+        inline bool empty() const noexcept { return _queue.empty(); }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept { return _queue.size(); }
+
+        [[nodiscard]]
+        inline size_t waitingConsumers() const noexcept
+        {
+            return _waitingConsumers.size();
+        }
+
+        template <typename... Args>
+        void emplace(Args&&... args)
+        {
+            if (_waitingConsumers.empty())
+            {
+                _queue.emplace(std::forward<Args>(args)...);
+
+                return;
+            }
+
+            PopAwaiter *consumer = _waitingConsumers.front();
+
+            _waitingConsumers.pop();
+            consumer->_value.emplace(std::forward<Args>(args)...);
+            _executor.schedule(consumer->_handle);
+        }
+
+        [[nodiscard]]
+        PopAwaiter pop() noexcept { return PopAwaiter(*this); }
+
+    private :
+        SingleThreadedExecutor& _executor;
+        CustomizedQueue<T, Policy> _queue;
+        CustomizedQueue<PopAwaiter *, StoragePolicy::Inline> _waitingConsumers;
+    };
+
+    // Statistics gathered by an instrumented queue
+    struct QueueStats
+    {
+        // Bucket 0 counts sojourn times of 0ns, bucket n of [2^(n-1), 2^n)ns
+        // and the last one everything above
+        static constexpr size_t SOJOURN_BUCKETS = 40;
+
+        size_t depthHighWaterMark = 0;
+        size_t popped = 0;
+        std::array<uint64_t, SOJOURN_BUCKETS> sojournHistogram{};
+
+        void recordSojourn(std::chrono::nanoseconds sojourn) noexcept
+        {
+            auto ns = static_cast<uint64_t>(std::max<int64_t>(sojourn.count(), 0));
+
+            ++sojournHistogram[std::min<size_t>(std::bit_width(ns), SOJOURN_BUCKETS - 1)];
+            ++popped;
+        }
+
+        // Upper bound of the bucket reached by the given fraction (0 to 1) of
+        // popped elements, e.g. 0.99 for the 99th percentile
+        [[nodiscard]]
+        std::chrono::nanoseconds sojournPercentile(double fraction) const noexcept
+        {
+            auto threshold = static_cast<uint64_t>(fraction * popped);
+            uint64_t cumulated = 0;
+
+            for (size_t n = 0; n < SOJOURN_BUCKETS; ++n)
+            {
+                cumulated += sojournHistogram[n];
+
+                if (cumulated >= threshold && cumulated > 0)
+                {
+                    return std::chrono::nanoseconds(uint64_t(1) << n);
+                }
+            }
+
+            return std::chrono::nanoseconds(0);
+        }
+    };
+
+    /* CustomizedQueue recording its depth high-water mark and the time
+       spent by elements inside (sojourn time) in a log-bucketed histogram.
+       Enqueue timestamps are kept in a second queue beside the elements.
+       Disabled by default : build with -DCUSTOMIZED_QUEUE_INSTRUMENTATION=1
+       to turn it on, otherwise it compiles down to a plain CustomizedQueue */
+    template <typename T,
+              StoragePolicy Policy = StoragePolicy::Indirect,
+              bool Enabled = CUSTOMIZED_QUEUE_INSTRUMENTATION>
+    class InstrumentedCustomizedQueue
+    {
+        using Clock_t = std::chrono::steady_clock;
+
+        struct Instrumentation
+        {
+            CustomizedQueue<Clock_t::time_point, StoragePolicy::Inline> enqueueTimes;
+            QueueStats stats;
+        };
+
+        struct NoInstrumentation { };
+
+    public :
+        [[nodiscard]]
+        inline bool empty() const noexcept { return _queue.empty(); }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept { return _queue.size(); }
+
+        [[nodiscard]]
+        inline const QueueStats& stats() const noexcept requires Enabled
+        {
+            return _instrumentation.stats;
+        }
+
+        template <typename... Args>
+        void emplace(Args&&... args)
+        {
+            _queue.emplace(std::forward<Args>(args)...);
+
+            if constexpr (Enabled)
+            {
+                auto& [enqueueTimes, stats] = _instrumentation;
+
+                enqueueTimes.emplace(Clock_t::now());
+                stats.depthHighWaterMark = std::max(stats.depthHighWaterMark,
+                                                    _queue.size());
+            }
+        }
+
+        void pop()
+        {
+            _queue.pop();
+
+            if constexpr (Enabled)
+            {
+                auto& [enqueueTimes, stats] = _instrumentation;
+
+                stats.recordSojourn(Clock_t::now() - enqueueTimes.front());
+                enqueueTimes.pop();
+            }
+        }
+
+        [[nodiscard]]
+        const T& front() const { return _queue.front(); }
+
+        [[nodiscard]]
+        T& front() { return _queue.front(); }
+
+    private :
+        CustomizedQueue<T, Policy> _queue;
+        [[no_unique_address]]
+        std::conditional_t<Enabled, Instrumentation, NoInstrumentation> _instrumentation;
+    };
+
+    static_assert(sizeof(InstrumentedCustomizedQueue<int, StoragePolicy::Indirect, false>) ==
+                  sizeof(CustomizedQueue<int>),
+                  "disabled instrumentation must not cost any memory");
+
+    // Queues allocating from a std::pmr::memory_resource, like std::pmr containers
+    namespace pmr
+    {
+        template <typename T, StoragePolicy Policy = StoragePolicy::Indirect>
+        using CustomizedQueue =
+            ::CustomizedQueue<T, Policy, std::pmr::polymorphic_allocator<T>>;
+
+        template <typename T, StoragePolicy Policy = StoragePolicy::Indirect>
+        using BlockingCustomizedQueue =
+            ::BlockingCustomizedQueue<T, Policy, std::pmr::polymorphic_allocator<T>>;
+    }
+
+    // Returns the average time in nanoseconds of one call of func
+    template <typename Func>
+    double measureNsPerOp(size_t nbOps, Func&& func)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t n = 0; n < nbOps; ++n)
+        {
+            func();
+        }
+
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        return elapsed.count() / nbOps;
+    }
+}
+
+using testing::StrictMock;
+using testing::ElementsAre;
+
+TEST(CustomizedQueue, Test_1)
+{
+    CustomizedQueue<int> cq;
+
+    ASSERT_TRUE(cq.empty());
+    ASSERT_EQ(cq.size(), 0);
+
+    cq.emplace(1);
+    cq.emplace(2);
+    cq.emplace(3);
+    cq.emplace(4);
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 4);
+    EXPECT_EQ(cq.front(), 1);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 3);
+    EXPECT_EQ(cq.front(), 2);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 2);
+    EXPECT_EQ(cq.front(), 3);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 1);
+    EXPECT_EQ(cq.front(), 4);
+
+    cq.pop();
+
+    ASSERT_TRUE(cq.empty());
+    ASSERT_EQ(cq.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+
+    const auto& cq2 = cq;
+
+    ASSERT_TRUE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] const auto& _ = cq2.front(); },
+                 std::runtime_error);
+}
+
+TEST(CustomizedQueue, Test_2)
+{
+    CustomizedQueue<int> cq;
+
+    ASSERT_TRUE(cq.empty());
+    ASSERT_EQ(cq.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+
+    cq.emplace(1);
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 1);
+    EXPECT_EQ(cq.front(), 1);
+
+    cq.pop();
+
+    ASSERT_TRUE(cq.empty());
+    ASSERT_EQ(cq.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+
+    cq.emplace(2);
+    cq.emplace(3);
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 2);
+    EXPECT_EQ(cq.front(), 2);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 1);
+    EXPECT_EQ(cq.front(), 3);
+
+    cq.emplace(4);
+    cq.emplace(5);
+    cq.emplace(6);
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 4);
+    EXPECT_EQ(cq.front(), 3);
+
+    const auto& cq2 = cq;
+
+    cq.pop();
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 3);
+    EXPECT_EQ(cq2.front(), 4);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 2);
+    EXPECT_EQ(cq2.front(), 5);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 1);
+    EXPECT_EQ(cq2.front(), 6);
+
+    cq.pop();
+
+    ASSERT_TRUE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] const auto& _ = cq2.front(); },
+                 std::runtime_error);
+}
+
+class Mock
+{
+public :
+    MOCK_METHOD(void, onCopyConstructor, (), (const, noexcept));
+    MOCK_METHOD(void, onMoveConstructor, (), (const, noexcept));
+    MOCK_METHOD(void, onCopyAssignment, (), (const, noexcept));
+    MOCK_METHOD(void, onMoveAssignment, (), (const, noexcept));
+};
+
+class TestObject
+{
+public :
+    static StrictMock<Mock> *_mockPtr;
+
+    TestObject(int value) noexcept : _value(value) { }
+
+    TestObject(const TestObject&)
+    {
+        if (_mockPtr)
+        {
+            _mockPtr->onCopyConstructor();
+        }
+    }
+
+    TestObject(TestObject&&)
+    {
+        if (_mockPtr)
+        {
+            _mockPtr->onMoveConstructor();
+        }
+    }
+
+    TestObject& operator=(const TestObject&)
+    {
+        if (_mockPtr)
+        {
+            _mockPtr->onCopyAssignment();
+        }
+
+        return *this;
+    }
+
+    TestObject& operator=(TestObject&&)
+    {
         if (_mockPtr)
         {
-            _mockPtr->onCopyAssignment();
+            _mockPtr->onCopyAssignment();
+        }
+
+        return *this;
+    }
+
+    inline int getValue() const noexcept { return _value; }
+
+private :
+    int _value;
+};
+
+StrictMock<Mock> *TestObject::_mockPtr = nullptr;
+
+class CustomizedQueueFixture : public testing::Test
+{
+protected :
+    StrictMock<Mock> _mock;
+
+    void SetUp() override { TestObject::_mockPtr = &_mock; }
+    void TearDown() override { TestObject::_mockPtr = nullptr; }
+};
+
+TEST_F(CustomizedQueueFixture, Test_3)
+{
+    CustomizedQueue<TestObject> cq;
+
+    ASSERT_TRUE(cq.empty());
+    ASSERT_EQ(cq.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+
+    cq.emplace(1);
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 1);
+    EXPECT_EQ(cq.front().getValue(), 1);
+
+    cq.pop();
+
+    ASSERT_TRUE(cq.empty());
+    ASSERT_EQ(cq.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+
+    cq.emplace(2);
+    cq.emplace(3);
+    cq.emplace(4);
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 3);
+    EXPECT_EQ(cq.front().getValue(), 2);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 2);
+    EXPECT_EQ(cq.front().getValue(), 3);
+
+    cq.emplace(5);
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 3);
+    EXPECT_EQ(cq.front().getValue(), 3);
+
+    const auto& cq2 = cq;
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 3);
+    EXPECT_EQ(cq2.front().getValue(), 3);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 2);
+    EXPECT_EQ(cq2.front().getValue(), 4);
+
+    cq.pop();
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 1);
+    EXPECT_EQ(cq2.front().getValue(), 5);
+
+    cq.pop();
+
+    ASSERT_TRUE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] const auto& _ = cq2.front(); },
+                 std::runtime_error);
+}
+
+TEST(CustomizedQueue, Test_4)
+{
+    CustomizedQueue<std::string, StoragePolicy::Inline> cq;
+
+    ASSERT_TRUE(cq.empty());
+    ASSERT_EQ(cq.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+
+    cq.emplace("a");
+    cq.emplace(2, 'b');
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 2);
+    EXPECT_EQ(cq.front(), "a");
+
+    cq.pop();
+    cq.emplace("c");
+    cq.emplace("d");
+
+    ASSERT_FALSE(cq.empty());
+    ASSERT_EQ(cq.size(), 3);
+    EXPECT_EQ(cq.front(), "bb");
+
+    cq.pop();
+
+    const auto& cq2 = cq;
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 2);
+    EXPECT_EQ(cq2.front(), "c");
+
+    cq.pop();
+    cq.emplace("e");
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 2);
+    EXPECT_EQ(cq2.front(), "d");
+
+    cq.pop();
+
+    ASSERT_FALSE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 1);
+    EXPECT_EQ(cq2.front(), "e");
+
+    cq.pop();
+
+    ASSERT_TRUE(cq2.empty());
+    ASSERT_EQ(cq2.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] const auto& _ = cq2.front(); },
+                 std::runtime_error);
+}
+
+// Each inlined element must be moved exactly once, when transferred
+// from the writing stack to the reading stack
+TEST_F(CustomizedQueueFixture, Test_5)
+{
+    CustomizedQueue<TestObject, StoragePolicy::Inline> cq;
+
+    cq.emplace(1);
+    cq.emplace(2);
+    cq.emplace(3);
+
+    EXPECT_CALL(_mock, onMoveConstructor()).Times(3);
+    [[maybe_unused]] auto& _ = cq.front();
+    testing::Mock::VerifyAndClearExpectations(&_mock);
+
+    cq.pop();
+    cq.emplace(4);
+    cq.emplace(5);
+    cq.pop();
+    cq.pop();
+
+    ASSERT_EQ(cq.size(), 2);
+
+    EXPECT_CALL(_mock, onMoveConstructor()).Times(2);
+    cq.pop();
+    testing::Mock::VerifyAndClearExpectations(&_mock);
+
+    cq.pop();
+
+    ASSERT_TRUE(cq.empty());
+}
+
+template <StoragePolicy Policy>
+void testBatchOperations()
+{
+    CustomizedQueue<int, Policy> cq;
+    std::vector<int> values{1, 2, 3, 4};
+    std::vector<int> popped;
+
+    cq.emplace_range(values.begin(), values.end());
+
+    ASSERT_EQ(cq.size(), 4);
+    EXPECT_EQ(cq.front(), 1);
+
+    // Reading stack holds [1, 2, 3, 4], writing stack [5, 6, 7]
+    values = {5, 6, 7};
+    cq.emplace_range(values.begin(), values.end());
+
+    EXPECT_EQ(cq.pop_n(std::back_inserter(popped), 2), 2);
+    EXPECT_THAT(popped, ElementsAre(1, 2));
+    ASSERT_EQ(cq.size(), 5);
+
+    popped.clear();
+
+    EXPECT_EQ(cq.pop_n(std::back_inserter(popped), 4), 4);
+    EXPECT_THAT(popped, ElementsAre(3, 4, 5, 6));
+    ASSERT_EQ(cq.size(), 1);
+    EXPECT_EQ(cq.front(), 7);
+
+    cq.emplace(8);
+    cq.emplace(9);
+    popped.clear();
+
+    EXPECT_EQ(cq.pop_n(std::back_inserter(popped), 10), 3);
+    EXPECT_THAT(popped, ElementsAre(7, 8, 9));
+    ASSERT_TRUE(cq.empty());
+    EXPECT_EQ(cq.pop_n(std::back_inserter(popped), 10), 0);
+
+    cq.emplace(10);
+    cq.emplace(11);
+    ASSERT_EQ(cq.front(), 10);
+    cq.emplace(12);
+    popped.clear();
+
+    EXPECT_EQ(cq.drain([&popped](int value) { popped.push_back(value); }), 3);
+    EXPECT_THAT(popped, ElementsAre(10, 11, 12));
+    ASSERT_TRUE(cq.empty());
+    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+
+    cq.emplace(13);
+    EXPECT_EQ(cq.front(), 13);
+}
+
+TEST(CustomizedQueue, Test_6)
+{
+    testBatchOperations<StoragePolicy::Indirect>();
+    testBatchOperations<StoragePolicy::Inline>();
+}
+
+namespace
+{
+    // Per thread so counting doesn't slow down the benchmarks
+    thread_local size_t globalAllocationsCount = 0;
+}
+
+// Counts allocations made through the global operator new
+void *operator new(size_t size)
+{
+    ++globalAllocationsCount;
+
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+// Not inlined into callers, GCC would report free() on a new-ed pointer
+[[gnu::noinline]]
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+[[gnu::noinline]]
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+template <StoragePolicy Policy>
+void testNoGlobalAllocationAfterWarmUp()
+{
+    constexpr int ELEMENTS_TOTAL = 10'000;
+    std::pmr::unsynchronized_pool_resource pool;
+    pmr::CustomizedQueue<std::pmr::string, Policy> cq(&pool);
+    auto fillAndEmpty = [&cq]()
+    {
+        for (int n = 0; n < ELEMENTS_TOTAL; ++n)
+        {
+            // Too long for the small string optimization
+            cq.emplace("a string allocated from the pool resource");
+
+            if (n % 3 == 0)
+            {
+                cq.pop();
+            }
+        }
+
+        while (!cq.empty())
+        {
+            cq.pop();
+        }
+    };
+
+    ASSERT_EQ(cq.get_allocator().resource(), &pool);
+
+    // Warm-up : the pool gets its chunks from the global operator new
+    fillAndEmpty();
+
+    size_t globalAllocationsBefore = globalAllocationsCount;
+
+    fillAndEmpty();
+    fillAndEmpty();
+
+    EXPECT_EQ(globalAllocationsCount, globalAllocationsBefore);
+}
+
+TEST(CustomizedQueue, Test_7)
+{
+    testNoGlobalAllocationAfterWarmUp<StoragePolicy::Indirect>();
+    testNoGlobalAllocationAfterWarmUp<StoragePolicy::Inline>();
+}
+
+TEST(CustomizedQueue, Test_8)
+{
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                              std::pmr::null_memory_resource());
+    size_t globalAllocationsBefore = globalAllocationsCount;
+
+    {
+        pmr::CustomizedQueue<int> cq(&arena);
+
+        cq.emplace(1);
+        cq.emplace(2);
+
+        EXPECT_EQ(cq.front(), 1);
+
+        cq.pop();
+        cq.emplace(3);
+
+        EXPECT_EQ(cq.front(), 2);
+        EXPECT_EQ(cq.size(), 2);
+    }
+
+    // Everything came from the stack buffer
+    EXPECT_EQ(globalAllocationsCount, globalAllocationsBefore);
+}
+
+TEST(SpillingCustomizedQueue, Test_1)
+{
+    SpillingCustomizedQueue<int> scq(2, 3);
+
+    ASSERT_TRUE(scq.empty());
+    ASSERT_EQ(scq.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = scq.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ scq.pop(); }, std::runtime_error);
+
+    // Head [0, 1], spilled [2, 3, 4, 5, 6, 7], tail [8, 9]
+    for (int n = 0; n < 10; ++n)
+    {
+        scq.emplace(n);
+    }
+
+    ASSERT_EQ(scq.size(), 10);
+    ASSERT_EQ(scq.spilledSize(), 6);
+
+    for (int n = 0; n < 5; ++n)
+    {
+        ASSERT_EQ(scq.front(), n);
+        scq.pop();
+    }
+
+    ASSERT_EQ(scq.spilledSize(), 2);
+
+    for (int n = 10; n < 15; ++n)
+    {
+        scq.emplace(n);
+    }
+
+    const auto& scq2 = scq;
+
+    for (int n = 5; n < 15; ++n)
+    {
+        ASSERT_EQ(scq2.size(), 15 - n);
+        ASSERT_EQ(scq2.front(), n);
+        scq.pop();
+    }
+
+    ASSERT_TRUE(scq2.empty());
+    ASSERT_EQ(scq2.spilledSize(), 0);
+    EXPECT_THROW({ [[maybe_unused]] const auto& _ = scq2.front(); },
+                 std::runtime_error);
+}
+
+TEST(SpillingCustomizedQueue, Test_2)
+{
+    struct Message
+    {
+        int id;
+        double value;
+        char tag[4];
+    };
+
+    constexpr int ELEMENTS_TOTAL = 200'000;
+    SpillingCustomizedQueue<Message> scq(64, 256);
+    int expected = 0;
+
+    // Segment grows and is reused once fully read back
+    for (int n = 0; n < ELEMENTS_TOTAL; ++n)
+    {
+        scq.emplace(Message{n, n * 0.5, {'a', 'b', 'c', '\0'}});
+
+        if (n % 4 == 0)
+        {
+            ASSERT_EQ(scq.front().id, expected);
+            scq.pop();
+            ++expected;
         }
+    }
 
-        return *this;
+    EXPECT_GT(scq.spilledSize(), 0);
+
+    for (; expected < ELEMENTS_TOTAL; ++expected)
+    {
+        const Message& message = scq.front();
+
+        ASSERT_EQ(message.id, expected);
+        ASSERT_EQ(message.value, expected * 0.5);
+        ASSERT_STREQ(message.tag, "abc");
+        scq.pop();
     }
 
-    TestObject& operator=(TestObject&&)
+    EXPECT_TRUE(scq.empty());
+}
+
+// The consumer never catches up : the spill file only grows with the
+// elements spilled at the same time, not with all those ever spilled
+TEST(SpillingCustomizedQueue, Test_3)
+{
+    constexpr int64_t BACKLOG = 100'000;
+    SpillingCustomizedQueue<int64_t> scq(64, 256);
+    int64_t expected = 0;
+
+    for (int64_t n = 0; n < BACKLOG; ++n)
     {
-        if (_mockPtr)
+        scq.emplace(n);
+    }
+
+    for (int64_t n = BACKLOG; n < 20 * BACKLOG; ++n)
+    {
+        scq.emplace(n);
+        ASSERT_EQ(scq.front(), expected++);
+        scq.pop();
+    }
+
+    EXPECT_GT(scq.spilledSize(), 0);
+    EXPECT_LE(scq.spillCapacity(), 4 * BACKLOG * sizeof(int64_t));
+
+    for (; expected < 20 * BACKLOG; ++expected)
+    {
+        ASSERT_EQ(scq.front(), expected);
+        scq.pop();
+    }
+
+    EXPECT_TRUE(scq.empty());
+}
+
+namespace
+{
+    // Coroutine started eagerly, destroying itself once finished
+    struct DetachedTask
+    {
+        struct promise_type
         {
-            _mockPtr->onCopyAssignment();
+            DetachedTask get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept { }
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    DetachedTask consume(AwaitableCustomizedQueue<std::string>& queue,
+                         size_t count,
+                         std::vector<std::string>& results)
+    {
+        for (size_t n = 0; n < count; ++n)
+        {
+            results.emplace_back(co_await queue.pop());
         }
+    }
+}
 
-        return *this;
+TEST(AwaitableCustomizedQueue, Test_1)
+{
+    SingleThreadedExecutor executor;
+    AwaitableCustomizedQueue<std::string> acq(executor);
+    std::vector<std::string> results;
+
+    acq.emplace("a");
+    acq.emplace("b");
+
+    // Available elements don't suspend the consumer
+    consume(acq, 2, results);
+    EXPECT_THAT(results, ElementsAre("a", "b"));
+    EXPECT_TRUE(acq.empty());
+    EXPECT_EQ(acq.waitingConsumers(), 0);
+
+    results.clear();
+    consume(acq, 3, results);
+
+    EXPECT_TRUE(results.empty());
+    EXPECT_EQ(acq.waitingConsumers(), 1);
+
+    acq.emplace("c");
+    acq.emplace("d");
+
+    // The consumer only runs again from the executor
+    EXPECT_TRUE(results.empty());
+    EXPECT_EQ(acq.size(), 1);
+
+    executor.run();
+
+    EXPECT_THAT(results, ElementsAre("c", "d"));
+    EXPECT_EQ(acq.waitingConsumers(), 1);
+
+    acq.emplace("e");
+    executor.run();
+
+    EXPECT_THAT(results, ElementsAre("c", "d", "e"));
+    EXPECT_EQ(acq.waitingConsumers(), 0);
+    EXPECT_TRUE(acq.empty());
+}
+
+// Thousands of consumers waiting on a single thread, served in order
+TEST(AwaitableCustomizedQueue, Test_2)
+{
+    constexpr size_t CONSUMERS_TOTAL = 10'000;
+    SingleThreadedExecutor executor;
+    AwaitableCustomizedQueue<std::string> acq(executor);
+    std::vector<std::vector<std::string>> results(CONSUMERS_TOTAL);
+
+    for (auto& consumerResults : results)
+    {
+        consume(acq, 1, consumerResults);
     }
 
-    inline int getValue() const noexcept { return _value; }
+    ASSERT_EQ(acq.waitingConsumers(), CONSUMERS_TOTAL);
 
-private :
-    int _value;
-};
+    for (size_t n = 0; n < CONSUMERS_TOTAL; ++n)
+    {
+        acq.emplace(std::to_string(n));
+    }
 
-StrictMock<Mock> *TestObject::_mockPtr = nullptr;
+    executor.run();
 
-class CustomizedQueueFixture : public testing::Test
+    EXPECT_EQ(acq.waitingConsumers(), 0);
+    EXPECT_TRUE(acq.empty());
+
+    for (size_t n = 0; n < CONSUMERS_TOTAL; ++n)
+    {
+        ASSERT_THAT(results[n], ElementsAre(std::to_string(n)));
+    }
+}
+
+TEST(InstrumentedCustomizedQueue, Test_1)
 {
-protected :
-    StrictMock<Mock> _mock;
+    using namespace std::chrono_literals;
 
-    void SetUp() override { TestObject::_mockPtr = &_mock; }
-    void TearDown() override { TestObject::_mockPtr = nullptr; }
-};
+    InstrumentedCustomizedQueue<int, StoragePolicy::Inline, true> icq;
 
-TEST_F(CustomizedQueueFixture, Test_3)
+    EXPECT_EQ(icq.stats().depthHighWaterMark, 0);
+    EXPECT_EQ(icq.stats().popped, 0);
+    EXPECT_EQ(icq.stats().sojournPercentile(0.5), 0ns);
+
+    icq.emplace(1);
+    icq.emplace(2);
+    icq.emplace(3);
+    icq.pop();
+    icq.pop();
+    icq.emplace(4);
+
+    EXPECT_EQ(icq.stats().depthHighWaterMark, 3);
+    EXPECT_EQ(icq.stats().popped, 2);
+
+    std::this_thread::sleep_for(2ms);
+    EXPECT_EQ(icq.front(), 3);
+    icq.pop();
+    icq.pop();
+
+    const QueueStats& stats = icq.stats();
+    uint64_t histogramTotal = 0;
+
+    for (auto count : stats.sojournHistogram)
+    {
+        histogramTotal += count;
+    }
+
+    EXPECT_TRUE(icq.empty());
+    EXPECT_EQ(stats.popped, 4);
+    EXPECT_EQ(histogramTotal, 4);
+    // The two elements which waited have a sojourn time above 2ms
+    EXPECT_GE(stats.sojournPercentile(1.0), 2ms);
+    EXPECT_LT(stats.sojournPercentile(0.5), 2ms);
+}
+
+TEST(InstrumentedCustomizedQueue, Test_2)
 {
-    CustomizedQueue<TestObject> cq;
+    InstrumentedCustomizedQueue<int, StoragePolicy::Indirect, false> icq;
 
-    ASSERT_TRUE(cq.empty());
-    ASSERT_EQ(cq.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
-                 std::runtime_error);
-    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+    icq.emplace(1);
+    icq.emplace(2);
 
-    cq.emplace(1);
+    EXPECT_EQ(icq.size(), 2);
+    EXPECT_EQ(icq.front(), 1);
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 1);
-    EXPECT_EQ(cq.front().getValue(), 1);
+    icq.pop();
 
-    cq.pop();
+    EXPECT_EQ(icq.front(), 2);
+}
 
-    ASSERT_TRUE(cq.empty());
-    ASSERT_EQ(cq.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] auto& _ = cq.front(); },
-                 std::runtime_error);
-    EXPECT_THROW({ cq.pop(); }, std::runtime_error);
+TEST(BlockingCustomizedQueue, Test_1)
+{
+    using namespace std::chrono_literals;
 
-    cq.emplace(2);
-    cq.emplace(3);
-    cq.emplace(4);
+    BlockingCustomizedQueue<int> bcq;
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 3);
-    EXPECT_EQ(cq.front().getValue(), 2);
+    ASSERT_TRUE(bcq.empty());
+    ASSERT_EQ(bcq.size(), 0);
+    EXPECT_EQ(bcq.try_pop(), std::nullopt);
+    EXPECT_EQ(bcq.wait_pop_for(1ms), std::nullopt);
 
-    cq.pop();
+    bcq.emplace(1);
+    bcq.emplace(2);
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 2);
-    EXPECT_EQ(cq.front().getValue(), 3);
+    ASSERT_EQ(bcq.size(), 2);
+    EXPECT_EQ(bcq.wait_pop(), 1);
+    EXPECT_EQ(bcq.wait_pop_for(1ms), 2);
+    ASSERT_TRUE(bcq.empty());
 
-    cq.emplace(5);
+    bcq.emplace(3);
+    bcq.close();
 
-    ASSERT_FALSE(cq.empty());
-    ASSERT_EQ(cq.size(), 3);
-    EXPECT_EQ(cq.front().getValue(), 3);
+    ASSERT_TRUE(bcq.closed());
+    EXPECT_THROW({ bcq.emplace(4); }, std::runtime_error);
+    EXPECT_EQ(bcq.try_pop(), 3);
+    EXPECT_EQ(bcq.wait_pop(), std::nullopt);
+    EXPECT_EQ(bcq.wait_pop_for(1h), std::nullopt);
+}
 
-    const auto& cq2 = cq;
+TEST(BlockingCustomizedQueue, Test_2)
+{
+    constexpr int ELEMENTS_TOTAL = 10'000;
+    constexpr int CONSUMERS_TOTAL = 4;
+    BlockingCustomizedQueue<int, StoragePolicy::Inline> bcq;
+    std::atomic<long> sum = 0;
+    std::vector<std::thread> consumers;
 
-    ASSERT_FALSE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 3);
-    EXPECT_EQ(cq2.front().getValue(), 3);
+    for (int n = 0; n < CONSUMERS_TOTAL; ++n)
+    {
+        consumers.emplace_back([&bcq, &sum]()
+        {
+            while (auto value = bcq.wait_pop())
+            {
+                sum += *value;
+            }
+        });
+    }
 
-    cq.pop();
+    for (int n = 1; n <= ELEMENTS_TOTAL; ++n)
+    {
+        bcq.emplace(n);
+    }
 
-    ASSERT_FALSE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 2);
-    EXPECT_EQ(cq2.front().getValue(), 4);
+    bcq.close();
 
-    cq.pop();
+    // Consumers only return once closed and drained
+    for (auto& consumer : consumers)
+    {
+        consumer.join();
+    }
 
-    ASSERT_FALSE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 1);
-    EXPECT_EQ(cq2.front().getValue(), 5);
+    EXPECT_TRUE(bcq.empty());
+    EXPECT_EQ(sum.load(), static_cast<long>(ELEMENTS_TOTAL) * (ELEMENTS_TOTAL + 1) / 2);
+}
 
-    cq.pop();
+namespace
+{
+    constexpr size_t BENCHMARK_OPS = 1'000'000;
 
-    ASSERT_TRUE(cq2.empty());
-    ASSERT_EQ(cq2.size(), 0);
-    EXPECT_THROW({ [[maybe_unused]] const auto& _ = cq2.front(); },
-                 std::runtime_error);
+    // Producer/consumer exchanging elements by batches of batchSize elements
+    template <StoragePolicy Policy, bool Batched>
+    double benchmarkBatch(size_t batchSize)
+    {
+        CustomizedQueue<int, Policy> cq;
+        std::vector<int> input(batchSize);
+        std::vector<int> output(batchSize);
+        volatile int sink = 0;
+
+        return measureNsPerOp(BENCHMARK_OPS / batchSize, [&]()
+        {
+            if constexpr (Batched)
+            {
+                cq.emplace_range(input.begin(), input.end());
+                cq.pop_n(output.begin(), batchSize);
+            }
+            else
+            {
+                for (int value : input)
+                {
+                    cq.emplace(value);
+                }
+
+                for (int& value : output)
+                {
+                    value = cq.front();
+                    cq.pop();
+                }
+            }
+
+            sink = sink + output.back();
+        }) / batchSize;
+    }
+
+    template <bool Enabled>
+    double benchmarkInstrumented(size_t depth)
+    {
+        InstrumentedCustomizedQueue<int, StoragePolicy::Inline, Enabled> icq;
+        volatile int sink = 0;
+
+        for (size_t n = 0; n < depth; ++n)
+        {
+            icq.emplace(static_cast<int>(n));
+        }
+
+        return measureNsPerOp(BENCHMARK_OPS, [&icq, &sink, n = 0]() mutable
+        {
+            icq.emplace(n++);
+            sink = sink + icq.front();
+            icq.pop();
+        });
+    }
+
+    // Producer/consumer running at the same pace around a constant queue depth
+    template <StoragePolicy Policy>
+    double benchmarkInterleaved(size_t depth)
+    {
+        CustomizedQueue<int, Policy> cq;
+        volatile int sink = 0;
+
+        for (size_t n = 0; n < depth; ++n)
+        {
+            cq.emplace(static_cast<int>(n));
+        }
+
+        return measureNsPerOp(BENCHMARK_OPS, [&cq, &sink, n = 0]() mutable
+        {
+            cq.emplace(n++);
+            sink = sink + cq.front();
+            cq.pop();
+        });
+    }
+
+    // Producer filling the queue by bursts, then consumer draining it
+    template <StoragePolicy Policy>
+    double benchmarkBurst(size_t burstSize)
+    {
+        CustomizedQueue<int, Policy> cq;
+        volatile int sink = 0;
+
+        return measureNsPerOp(BENCHMARK_OPS / burstSize, [&cq, &sink, burstSize]()
+        {
+            for (size_t n = 0; n < burstSize; ++n)
+            {
+                cq.emplace(static_cast<int>(n));
+            }
+
+            while (!cq.empty())
+            {
+                sink = sink + cq.front();
+                cq.pop();
+            }
+        }) / burstSize;
+    }
+}
+
+// Benchmarks are disabled by default, run them with --gtest_also_run_disabled_tests
+TEST(CustomizedQueueBenchmark, DISABLED_Interleaved)
+{
+    for (size_t depth : {1, 64, 4096})
+    {
+        std::cout << "interleaved depth=" << depth
+                  << " indirect=" << benchmarkInterleaved<StoragePolicy::Indirect>(depth)
+                  << "ns/op inline=" << benchmarkInterleaved<StoragePolicy::Inline>(depth)
+                  << "ns/op" << std::endl;
+    }
+}
+
+TEST(CustomizedQueueBenchmark, DISABLED_Burst)
+{
+    for (size_t burstSize : {16, 1024, 65536})
+    {
+        std::cout << "burst size=" << burstSize
+                  << " indirect=" << benchmarkBurst<StoragePolicy::Indirect>(burstSize)
+                  << "ns/op inline=" << benchmarkBurst<StoragePolicy::Inline>(burstSize)
+                  << "ns/op" << std::endl;
+    }
+}
+
+TEST(CustomizedQueueBenchmark, DISABLED_Batch)
+{
+    for (size_t batchSize : {16, 1024})
+    {
+        std::cout << "batch size=" << batchSize
+                  << " indirect single=" << benchmarkBatch<StoragePolicy::Indirect, false>(batchSize)
+                  << "ns/op batched=" << benchmarkBatch<StoragePolicy::Indirect, true>(batchSize)
+                  << "ns/op inline single=" << benchmarkBatch<StoragePolicy::Inline, false>(batchSize)
+                  << "ns/op batched=" << benchmarkBatch<StoragePolicy::Inline, true>(batchSize)
+                  << "ns/op" << std::endl;
+    }
+}
+
+// Time between emplace() and the return of wait_pop() in a consumer
+// which had time to park
+TEST(CustomizedQueueBenchmark, DISABLED_WakeUpLatency)
+{
+    using namespace std::chrono_literals;
+    using Clock_t = std::chrono::steady_clock;
+
+    constexpr int WAKE_UPS = 1000;
+    BlockingCustomizedQueue<Clock_t::time_point> bcq;
+    std::chrono::duration<double, std::micro> totalLatency{0};
+    std::thread consumer([&bcq, &totalLatency]()
+    {
+        while (auto emplaceTime = bcq.wait_pop())
+        {
+            totalLatency += Clock_t::now() - *emplaceTime;
+        }
+    });
+
+    for (int n = 0; n < WAKE_UPS; ++n)
+    {
+        std::this_thread::sleep_for(1ms);
+        bcq.emplace(Clock_t::now());
+    }
+
+    bcq.close();
+    consumer.join();
+    std::cout << "wake-up latency=" << totalLatency.count() / WAKE_UPS
+              << "us" << std::endl;
+}
+
+// Fills then empties the queue, most elements going through the disk when spilling
+TEST(CustomizedQueueBenchmark, DISABLED_Spilling)
+{
+    constexpr size_t ELEMENTS_TOTAL = 10'000'000;
+    CustomizedQueue<int64_t, StoragePolicy::Inline> inMemory;
+    SpillingCustomizedQueue<int64_t> spilling(4096, 4096);
+    volatile int64_t sink = 0;
+    auto benchmark = [&sink](auto& queue)
+    {
+        return measureNsPerOp(1, [&queue, &sink]()
+        {
+            for (size_t n = 0; n < ELEMENTS_TOTAL; ++n)
+            {
+                queue.emplace(static_cast<int64_t>(n));
+            }
+
+            while (!queue.empty())
+            {
+                sink = sink + queue.front();
+                queue.pop();
+            }
+        }) / ELEMENTS_TOTAL;
+    };
+
+    std::cout << "in-memory=" << benchmark(inMemory)
+              << "ns/op spilling=" << benchmark(spilling)
+              << "ns/op" << std::endl;
+}
+
+TEST(CustomizedQueueBenchmark, DISABLED_Instrumentation)
+{
+    for (size_t depth : {1, 4096})
+    {
+        std::cout << "interleaved depth=" << depth
+                  << " instrumentation off=" << benchmarkInstrumented<false>(depth)
+                  << "ns/op on=" << benchmarkInstrumented<true>(depth)
+                  << "ns/op" << std::endl;
+    }
 }
 
 int main(int argc, char **argv)
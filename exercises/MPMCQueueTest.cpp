@@ -0,0 +1,488 @@
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <gtest/gtest.h>
+
+namespace
+{
+    // Fixed, std::hardware_destructive_interference_size isn't ABI stable
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /* Lock-free bounded queue shared by many producer and consumer threads.
+       Each slot of the ring buffer holds a sequence number telling whether it
+       is ready to be written (sequence == position) or read
+       (sequence == position + 1) for the current lap, so threads only
+       compete through a CAS on the enqueue or dequeue position.
+       Unlike CustomizedQueue there is no front() : another consumer could pop
+       the element while it is being read, so pop() returns it instead */
+    template <typename T>
+    class MPMCQueue
+    {
+    public :
+        explicit MPMCQueue(size_t capacity)
+            : _mask(std::bit_ceil(capacity) - 1),
+              _cells(std::make_unique<Cell[]>(_mask + 1))
+        {
+            for (size_t n = 0; n <= _mask; ++n)
+            {
+                _cells[n].sequence.store(n, std::memory_order_relaxed);
+            }
+        }
+
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+        ~MPMCQueue()
+        {
+            size_t end = _enqueuePos.load(std::memory_order_relaxed);
+
+            for (size_t pos = _dequeuePos.load(std::memory_order_relaxed); pos != end; ++pos)
+            {
+                getValue(_cells[pos & _mask]).~T();
+            }
+        }
+
+        [[nodiscard]]
+        inline size_t capacity() const noexcept { return _mask + 1; }
+
+        // Approximated while other threads are using the queue
+        [[nodiscard]]
+        inline bool empty() const noexcept { return size() == 0; }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept
+        {
+            size_t dequeuePos = _dequeuePos.load(std::memory_order_acquire);
+
+            return _enqueuePos.load(std::memory_order_acquire) - dequeuePos;
+        }
+
+        // Returns false if the queue is full
+        template <typename... Args>
+        [[nodiscard]]
+        bool try_emplace(Args&&... args)
+        {
+            size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+            Cell *cell;
+
+            while (true)
+            {
+                cell = &_cells[pos & _mask];
+
+                auto diff = static_cast<std::ptrdiff_t>(
+                    cell->sequence.load(std::memory_order_acquire) - pos);
+
+                if (diff == 0)
+                {
+                    if (_enqueuePos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = _enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            new (cell->data) T(std::forward<Args>(args)...);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Spins until a consumer makes room
+        template <typename... Args>
+        void emplace(Args&&... args)
+        {
+            while (!try_emplace(std::forward<Args>(args)...))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // Returns false if the queue is empty
+        [[nodiscard]]
+        bool try_pop(T& value)
+        {
+            size_t pos;
+            Cell *cell = claimFront(pos);
+
+            if (!cell)
+            {
+                return false;
+            }
+
+            ReleaseGuard guard{cell, pos + _mask + 1};
+
+            value = std::move(getValue(*cell));
+
+            return true;
+        }
+
+        // Moves the element straight from its cell, T needs no default constructor
+        [[nodiscard]]
+        T pop()
+        {
+            size_t pos;
+            Cell *cell = claimFront(pos);
+
+            if (!cell)
+            {
+                throw std::runtime_error("queue is empty");
+            }
+
+            ReleaseGuard guard{cell, pos + _mask + 1};
+
+            return std::move(getValue(*cell));
+        }
+
+    private :
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            alignas(T) std::byte data[sizeof(T)];
+        };
+
+        alignas(CACHE_LINE_SIZE) const size_t _mask;
+        std::unique_ptr<Cell[]> _cells;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> _enqueuePos = 0;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> _dequeuePos = 0;
+
+        [[nodiscard]]
+        static inline T& getValue(Cell& cell) noexcept
+        {
+            return *std::launder(reinterpret_cast<T *>(cell.data));
+        }
+
+        /* Destroys the popped element and makes its cell ready to be written
+           on the next lap, even when moving the element out throws : the
+           element is lost then, but the queue isn't stuck on that cell */
+        struct ReleaseGuard
+        {
+            Cell *cell;
+            size_t nextSequence;
+
+            ~ReleaseGuard()
+            {
+                getValue(*cell).~T();
+                cell->sequence.store(nextSequence, std::memory_order_release);
+            }
+        };
+
+        // Front cell, now owned by the calling consumer, or nullptr if the queue is empty
+        [[nodiscard]]
+        Cell *claimFront(size_t& pos) noexcept
+        {
+            pos = _dequeuePos.load(std::memory_order_relaxed);
+
+            while (true)
+            {
+                Cell *cell = &_cells[pos & _mask];
+
+                auto diff = static_cast<std::ptrdiff_t>(
+                    cell->sequence.load(std::memory_order_acquire) - (pos + 1));
+
+                if (diff == 0)
+                {
+                    if (_dequeuePos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        return cell;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return nullptr;
+                }
+                else
+                {
+                    pos = _dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+}
+
+TEST(MPMCQueueTest, Test_1)
+{
+    MPMCQueue<int> queue(3);
+    int value = 0;
+
+    ASSERT_EQ(queue.capacity(), 4);
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(queue.size(), 0);
+    EXPECT_FALSE(queue.try_pop(value));
+    EXPECT_THROW({ [[maybe_unused]] auto _ = queue.pop(); }, std::runtime_error);
+
+    queue.emplace(1);
+    queue.emplace(2);
+    queue.emplace(3);
+    queue.emplace(4);
+
+    ASSERT_FALSE(queue.empty());
+    ASSERT_EQ(queue.size(), 4);
+    EXPECT_FALSE(queue.try_emplace(5));
+    EXPECT_EQ(queue.pop(), 1);
+    ASSERT_EQ(queue.size(), 3);
+    EXPECT_TRUE(queue.try_emplace(5));
+    EXPECT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(value, 2);
+    EXPECT_EQ(queue.pop(), 3);
+    EXPECT_EQ(queue.pop(), 4);
+    ASSERT_EQ(queue.size(), 1);
+    EXPECT_EQ(queue.pop(), 5);
+    ASSERT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(MPMCQueueTest, Test_2)
+{
+    auto element = std::make_shared<int>(42);
+
+    {
+        MPMCQueue<std::shared_ptr<int>> queue(4);
+
+        for (uint32_t n = 0; n < 10; ++n)
+        {
+            queue.emplace(element);
+            EXPECT_EQ(*queue.pop(), 42);
+        }
+
+        queue.emplace(element);
+        queue.emplace(element);
+        EXPECT_EQ(element.use_count(), 3);
+    }
+
+    // Remaining elements are destroyed with the queue
+    EXPECT_EQ(element.use_count(), 1);
+}
+
+// Every value pushed by any producer is popped exactly once by any consumer
+TEST(MPMCQueueTest, Test_3)
+{
+    constexpr int PRODUCERS_TOTAL = 4;
+    constexpr int CONSUMERS_TOTAL = 4;
+    constexpr int ELEMENTS_PER_PRODUCER = 50'000;
+    constexpr int ELEMENTS_TOTAL = PRODUCERS_TOTAL * ELEMENTS_PER_PRODUCER;
+    MPMCQueue<int> queue(128);
+    std::vector<std::atomic<int>> popCounts(ELEMENTS_TOTAL);
+    std::atomic<int> popped = 0;
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < PRODUCERS_TOTAL; ++p)
+    {
+        threads.emplace_back([&queue, p]()
+        {
+            for (int n = 0; n < ELEMENTS_PER_PRODUCER; ++n)
+            {
+                queue.emplace(p * ELEMENTS_PER_PRODUCER + n);
+            }
+        });
+    }
+
+    for (int c = 0; c < CONSUMERS_TOTAL; ++c)
+    {
+        threads.emplace_back([&queue, &popCounts, &popped]()
+        {
+            int value;
+
+            while (popped.load() < ELEMENTS_TOTAL)
+            {
+                if (queue.try_pop(value))
+                {
+                    ++popCounts[value];
+                    ++popped;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_TRUE(queue.empty());
+
+    for (const auto& popCount : popCounts)
+    {
+        ASSERT_EQ(popCount.load(), 1);
+    }
+}
+
+// Elements without default constructor, whose move throws
+TEST(MPMCQueueTest, Test_4)
+{
+    struct Element
+    {
+        explicit Element(int value) : value(value) {}
+
+        Element(Element&& other) : value(other.value)
+        {
+            if (value < 0)
+            {
+                throw std::runtime_error("move failed");
+            }
+        }
+
+        Element& operator=(Element&& other)
+        {
+            value = other.value;
+
+            if (value < 0)
+            {
+                throw std::runtime_error("move failed");
+            }
+
+            return *this;
+        }
+
+        int value;
+    };
+
+    MPMCQueue<Element> queue(2);
+    Element element(0);
+
+    queue.emplace(-1);
+    queue.emplace(1);
+    EXPECT_THROW({ [[maybe_unused]] auto _ = queue.pop(); }, std::runtime_error);
+    EXPECT_EQ(queue.pop().value, 1);
+
+    // The cells of the lost elements are writable again
+    queue.emplace(-2);
+    queue.emplace(2);
+    EXPECT_THROW({ [[maybe_unused]] auto _ = queue.try_pop(element); }, std::runtime_error);
+    EXPECT_TRUE(queue.try_pop(element));
+    EXPECT_EQ(element.value, 2);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_TRUE(queue.try_emplace(3));
+    EXPECT_TRUE(queue.try_emplace(4));
+}
+
+namespace
+{
+    constexpr size_t BENCHMARK_OPS = 2'000'000;
+
+    // Baseline : std::queue behind a mutex
+    class MutexQueue
+    {
+    public :
+        bool try_emplace(int value)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _queue.emplace(value);
+
+            return true;
+        }
+
+        bool try_pop(int& value)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            if (_queue.empty())
+            {
+                return false;
+            }
+
+            value = _queue.front();
+            _queue.pop();
+
+            return true;
+        }
+
+    private :
+        std::mutex _mutex;
+        std::queue<int> _queue;
+    };
+
+    // Returns the throughput in millions of transferred elements per second
+    // with nbThreads producers and as many consumers
+    template <typename Queue>
+    double benchmarkScaling(Queue& queue, size_t nbThreads)
+    {
+        size_t opsPerThread = BENCHMARK_OPS / nbThreads;
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t n = 0; n < nbThreads; ++n)
+        {
+            threads.emplace_back([&queue, opsPerThread]()
+            {
+                for (size_t op = 0; op < opsPerThread; ++op)
+                {
+                    while (!queue.try_emplace(static_cast<int>(op)))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            threads.emplace_back([&queue, opsPerThread]()
+            {
+                int value;
+
+                for (size_t op = 0; op < opsPerThread; ++op)
+                {
+                    while (!queue.try_pop(value))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        return (opsPerThread * nbThreads) / elapsed.count();
+    }
+}
+
+// Benchmarks are disabled by default, run them with --gtest_also_run_disabled_tests
+TEST(MPMCQueueBenchmark, DISABLED_Scaling)
+{
+    size_t maxThreads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (size_t nbThreads = 1; nbThreads <= maxThreads; nbThreads *= 2)
+    {
+        MPMCQueue<int> queue(1024);
+        MutexQueue mutexQueue;
+
+        std::cout << "producers=consumers=" << nbThreads
+                  << " mpmc=" << benchmarkScaling(queue, nbThreads)
+                  << "Mops/s mutex=" << benchmarkScaling(mutexQueue, nbThreads)
+                  << "Mops/s" << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,423 @@
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <gtest/gtest.h>
+
+namespace
+{
+    // Fixed instead of std::hardware_destructive_interference_size
+    // which isn't ABI stable across compiler flags
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /* Lock-free bounded queue with one producer thread (emplace) and one
+       consumer thread (front / pop), exposing the same API than
+       CustomizedQueue. Elements are stored inline in a ring buffer whose
+       capacity is rounded up to a power of 2. Each side owns its index on
+       its own cache line and keeps a cached copy of the opposite index,
+       only reloaded (atomically) when the ring looks full or empty */
+    template <typename T>
+    class SPSCQueue
+    {
+    public :
+        explicit SPSCQueue(size_t capacity)
+            : _mask(std::bit_ceil(capacity) - 1),
+              _slots(std::make_unique<Slot[]>(_mask + 1))
+        { }
+
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        ~SPSCQueue()
+        {
+            while (!empty())
+            {
+                pop();
+            }
+        }
+
+        [[nodiscard]]
+        inline size_t capacity() const noexcept { return _mask + 1; }
+
+        // Consumer side, the producer index is only reloaded when the cached one says empty
+        [[nodiscard]]
+        bool empty() const noexcept
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+
+            if (head != _cachedTail)
+            {
+                return false;
+            }
+
+            _cachedTail = _tail.load(std::memory_order_acquire);
+
+            return head == _cachedTail;
+        }
+
+        // Exact from the producer or the consumer, approximated from elsewhere
+        [[nodiscard]]
+        inline size_t size() const noexcept
+        {
+            size_t head = _head.load(std::memory_order_acquire);
+
+            return _tail.load(std::memory_order_acquire) - head;
+        }
+
+        // Producer side, returns false if the queue is full
+        template <typename... Args>
+        [[nodiscard]]
+        bool try_emplace(Args&&... args)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+
+            if (tail - _cachedHead == capacity())
+            {
+                _cachedHead = _head.load(std::memory_order_acquire);
+
+                if (tail - _cachedHead == capacity())
+                {
+                    return false;
+                }
+            }
+
+            new (_slots[tail & _mask].data) T(std::forward<Args>(args)...);
+            _tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Producer side, spins until the consumer makes room
+        template <typename... Args>
+        void emplace(Args&&... args)
+        {
+            while (!try_emplace(std::forward<Args>(args)...))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // Consumer side
+        void pop()
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+
+            getValue(checkNotEmpty(head)).~T();
+            _head.store(head + 1, std::memory_order_release);
+        }
+
+        // Consumer side
+        [[nodiscard]]
+        const T& front() const
+        {
+            return getValue(checkNotEmpty(_head.load(std::memory_order_relaxed)));
+        }
+
+        // Consumer side
+        [[nodiscard]]
+        T& front()
+        {
+            return getValue(checkNotEmpty(_head.load(std::memory_order_relaxed)));
+        }
+
+    private :
+        struct Slot
+        {
+            alignas(T) std::byte data[sizeof(T)];
+        };
+
+        // Consumer cache line
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head = 0;
+        mutable size_t _cachedTail = 0;
+
+        // Producer cache line
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail = 0;
+        size_t _cachedHead = 0;
+
+        // Read-only cache line, shared by both sides
+        alignas(CACHE_LINE_SIZE) const size_t _mask;
+        std::unique_ptr<Slot[]> _slots;
+
+        [[nodiscard]]
+        static inline T& getValue(Slot& slot) noexcept
+        {
+            return *std::launder(reinterpret_cast<T *>(slot.data));
+        }
+
+        [[nodiscard]]
+        Slot& checkNotEmpty(size_t head) const
+        {
+            if (head == _cachedTail)
+            {
+                _cachedTail = _tail.load(std::memory_order_acquire);
+
+                if (head == _cachedTail)
+                {
+                    throw std::runtime_error("queue is empty");
+                }
+            }
+
+            return _slots[head & _mask];
+        }
+    };
+
+    // Returns the average time in nanoseconds of one call of func
+    template <typename Func>
+    double measureNsPerOp(size_t nbOps, Func&& func)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t n = 0; n < nbOps; ++n)
+        {
+            func();
+        }
+
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        return elapsed.count() / nbOps;
+    }
+}
+
+TEST(SPSCQueueTest, Test_1)
+{
+    SPSCQueue<int> queue(3);
+
+    ASSERT_EQ(queue.capacity(), 4);
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(queue.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] auto& _ = queue.front(); },
+                 std::runtime_error);
+    EXPECT_THROW({ queue.pop(); }, std::runtime_error);
+
+    queue.emplace(1);
+    queue.emplace(2);
+    queue.emplace(3);
+    queue.emplace(4);
+
+    ASSERT_FALSE(queue.empty());
+    ASSERT_EQ(queue.size(), 4);
+    EXPECT_FALSE(queue.try_emplace(5));
+    EXPECT_EQ(queue.front(), 1);
+
+    queue.pop();
+
+    ASSERT_EQ(queue.size(), 3);
+    EXPECT_EQ(queue.front(), 2);
+    EXPECT_TRUE(queue.try_emplace(5));
+
+    queue.pop();
+
+    ASSERT_EQ(queue.size(), 3);
+    EXPECT_EQ(queue.front(), 3);
+
+    queue.pop();
+
+    const auto& queue2 = queue;
+
+    ASSERT_EQ(queue2.size(), 2);
+    EXPECT_EQ(queue2.front(), 4);
+
+    queue.pop();
+
+    ASSERT_EQ(queue2.size(), 1);
+    EXPECT_EQ(queue2.front(), 5);
+
+    queue.pop();
+
+    ASSERT_TRUE(queue2.empty());
+    ASSERT_EQ(queue2.size(), 0);
+    EXPECT_THROW({ [[maybe_unused]] const auto& _ = queue2.front(); },
+                 std::runtime_error);
+}
+
+TEST(SPSCQueueTest, Test_2)
+{
+    auto element = std::make_shared<int>(42);
+
+    {
+        SPSCQueue<std::shared_ptr<int>> queue(8);
+
+        for (uint32_t n = 0; n < 20; ++n)
+        {
+            queue.emplace(element);
+            EXPECT_EQ(*queue.front(), 42);
+            queue.pop();
+        }
+
+        queue.emplace(element);
+        queue.emplace(element);
+        EXPECT_EQ(element.use_count(), 3);
+    }
+
+    // Remaining elements are destroyed with the queue
+    EXPECT_EQ(element.use_count(), 1);
+}
+
+TEST(SPSCQueueTest, Test_3)
+{
+    constexpr int ELEMENTS_TOTAL = 1'000'000;
+    SPSCQueue<int> queue(64);
+    std::thread producer([&queue]()
+    {
+        for (int n = 0; n < ELEMENTS_TOTAL; ++n)
+        {
+            queue.emplace(n);
+        }
+    });
+    int expected = 0;
+
+    while (expected < ELEMENTS_TOTAL)
+    {
+        if (queue.empty())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_EQ(queue.front(), expected);
+        queue.pop();
+        ++expected;
+    }
+
+    producer.join();
+    EXPECT_TRUE(queue.empty());
+}
+
+namespace
+{
+    constexpr size_t BENCHMARK_OPS = 10'000'000;
+
+    // Baseline : std::queue behind a mutex, the consumer polling it
+    class MutexQueue
+    {
+    public :
+        void emplace(int value)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _queue.emplace(value);
+        }
+
+        bool tryPop(int& value)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            if (_queue.empty())
+            {
+                return false;
+            }
+
+            value = _queue.front();
+            _queue.pop();
+
+            return true;
+        }
+
+    private :
+        std::mutex _mutex;
+        std::queue<int> _queue;
+    };
+
+    template <typename Queue, typename TryPop>
+    double benchmarkThroughput(Queue& queue, TryPop&& tryPop)
+    {
+        std::thread producer([&queue]()
+        {
+            for (size_t n = 0; n < BENCHMARK_OPS; ++n)
+            {
+                queue.emplace(static_cast<int>(n));
+            }
+        });
+        int value;
+
+        double nsPerOp = measureNsPerOp(BENCHMARK_OPS, [&]()
+        {
+            while (!tryPop(value))
+            {
+                std::this_thread::yield();
+            }
+        });
+
+        producer.join();
+
+        return nsPerOp;
+    }
+}
+
+// Benchmarks are disabled by default, run them with --gtest_also_run_disabled_tests
+TEST(SPSCQueueBenchmark, DISABLED_Throughput)
+{
+    SPSCQueue<int> queue(1024);
+    MutexQueue mutexQueue;
+
+    double spscNsPerOp = benchmarkThroughput(queue, [&queue](int& value)
+    {
+        if (queue.empty())
+        {
+            return false;
+        }
+
+        value = queue.front();
+        queue.pop();
+
+        return true;
+    });
+    double mutexNsPerOp = benchmarkThroughput(mutexQueue, [&mutexQueue](int& value)
+    {
+        return mutexQueue.tryPop(value);
+    });
+
+    std::cout << "throughput spsc=" << 1e3 / spscNsPerOp
+              << "Mops/s mutex=" << 1e3 / mutexNsPerOp << "Mops/s" << std::endl;
+}
+
+// Round trip of one element between two threads through two queues
+TEST(SPSCQueueBenchmark, DISABLED_Latency)
+{
+    constexpr size_t ROUND_TRIPS = 1'000'000;
+    SPSCQueue<int> ping(16);
+    SPSCQueue<int> pong(16);
+    std::thread echo([&ping, &pong]()
+    {
+        for (size_t n = 0; n < ROUND_TRIPS; ++n)
+        {
+            while (ping.empty())
+            {
+                std::this_thread::yield();
+            }
+
+            pong.emplace(ping.front());
+            ping.pop();
+        }
+    });
+
+    double nsPerRoundTrip = measureNsPerOp(ROUND_TRIPS, [&ping, &pong]()
+    {
+        ping.emplace(1);
+
+        while (pong.empty())
+        {
+            std::this_thread::yield();
+        }
+
+        pong.pop();
+    });
+
+    echo.join();
+    std::cout << "latency one-way=" << nsPerRoundTrip / 2 << "ns" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
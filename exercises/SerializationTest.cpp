@@ -1,7 +1,51 @@
 #include <memory>
 #include <map>
+#include <deque>
 #include <array>
 #include <type_traits>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+#include <bit>
+#include <climits>
+#include <limits>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <optional>
+#include <iterator>
+#include <new>
+#include <cstdlib>
+#include <tuple>
+#include <variant>
+#include <concepts>
+#include <utility>
+#include <string>
+#include <cstring>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
@@ -23,11 +67,146 @@ namespace
             std::unique_ptr<Memory[]> data;
         };
 
+        // Growable buffer reused across serializations, it never shrinks
+        class OutputBuffer
+        {
+        public :
+            [[nodiscard]]
+            inline size_t size() const noexcept { return _size; }
+
+            [[nodiscard]]
+            inline size_t capacity() const noexcept { return _capacity; }
+
+            [[nodiscard]]
+            inline std::span<const SerializedData::Memory> bytes() const noexcept
+            {
+                return {_data.get(), _size};
+            }
+
+            inline void clear() noexcept { _size = 0; }
+
+            void reserve(size_t capacity)
+            {
+                if (capacity <= _capacity)
+                {
+                    return;
+                }
+
+                capacity = std::max(capacity, _capacity * 2);
+
+                auto data = std::make_unique_for_overwrite<SerializedData::Memory[]>(capacity);
+
+                if (_size > 0)
+                {
+                    std::memcpy(data.get(), _data.get(), _size);
+                }
+
+                _data = std::move(data);
+                _capacity = capacity;
+            }
+
+            // Returns the uninitialized size bytes appended at the end
+            [[nodiscard]]
+            std::span<SerializedData::Memory> append(size_t size)
+            {
+                reserve(_size + size);
+
+                std::span<SerializedData::Memory> appended(_data.get() + _size, size);
+
+                _size += size;
+
+                return appended;
+            }
+
+        private :
+            std::unique_ptr<SerializedData::Memory[]> _data;
+            size_t _size = 0;
+            size_t _capacity = 0;
+        };
+
         virtual ~SerDes() = default;
-        virtual SerializedData serialize() const = 0;
-        virtual void deserialize(const SerializedData&) = 0;
+        virtual size_t serializedSize() const = 0;
+        // Writes serializedSize() bytes at the beginning of buffer and returns that size
+        virtual size_t serializeInto(std::span<SerializedData::Memory> buffer) const = 0;
+        virtual void deserializeFrom(std::span<const SerializedData::Memory> data) = 0;
+
+        inline void deserialize(const SerializedData& data)
+        {
+            deserializeFrom({data.data.get(), data.size});
+        }
+
+        [[nodiscard]]
+        SerializedData serialize() const
+        {
+            size_t size = serializedSize();
+            SerializedData data =
+            {
+                size,
+                std::make_unique_for_overwrite<SerializedData::Memory[]>(size)
+            };
+
+            serializeInto({data.data.get(), size});
+
+            return data;
+        }
+
+        // Appends to buffer, returns the offset of the object in it
+        size_t serialize(OutputBuffer& buffer) const
+        {
+            size_t offset = buffer.size();
+
+            serializeInto(buffer.append(serializedSize()));
+
+            return offset;
+        }
     };
 
+    /* Packs objects back to back into one buffer in two passes : sizes are
+       summed first so the buffer grows at most once, then every object is
+       written in place. Returns the offset of each object in buffer */
+    template <typename Range>
+    std::vector<size_t> serializeAll(const Range& objects, SerDes::OutputBuffer& buffer)
+    {
+        std::vector<size_t> offsets;
+        size_t totalSize = 0;
+
+        for (const auto& object : objects)
+        {
+            offsets.push_back(buffer.size() + totalSize);
+            totalSize += object->serializedSize();
+        }
+
+        auto bytes = buffer.append(totalSize);
+        size_t offset = 0;
+
+        for (const auto& object : objects)
+        {
+            offset += object->serializeInto(bytes.subspan(offset));
+        }
+
+        return offsets;
+    }
+
+    // Reads or writes a T at any address, a single load or store where the target allows it
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    [[nodiscard]]
+    inline T loadUnaligned(const std::byte *ptr) noexcept
+    {
+        T value;
+
+        std::memcpy(&value, ptr, sizeof(value));
+
+        return value;
+    }
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    inline void storeUnaligned(std::byte *ptr, const T& value) noexcept
+    {
+        std::memcpy(ptr, &value, sizeof(value));
+    }
+
     struct Struct_1 : SerDes
     {
         using SerDes::SerializedData;
@@ -36,6 +215,8 @@ namespace
         float f;
         double d;
 
+        static constexpr auto fields = std::tuple{&Struct_1::n, &Struct_1::f, &Struct_1::d};
+
         Struct_1() = default;
 
         Struct_1(std::decay_t<decltype(n)> p_n,
@@ -47,41 +228,42 @@ namespace
         ~Struct_1() override = default;
 
         [[nodiscard]]
-        SerializedData serialize() const override
+        size_t serializedSize() const override
         {
-            constexpr size_t TOTAL_FIELDS_SIZE = sizeof(n) + sizeof(f) + sizeof(d);
-            SerializedData data =
-            {
-                TOTAL_FIELDS_SIZE,
-                std::make_unique<SerializedData::Memory[]>(TOTAL_FIELDS_SIZE)
-            };
-            auto *ptr = data.data.get();
+            return sizeof(n) + sizeof(f) + sizeof(d);
+        }
 
-            *reinterpret_cast<std::decay_t<decltype(n)> *>(ptr) = n;
+        size_t serializeInto(std::span<SerializedData::Memory> buffer) const override
+        {
+            assertm(buffer.size() >= serializedSize(), "Buffer is too small");
+
+            auto *ptr = buffer.data();
+
+            storeUnaligned<std::decay_t<decltype(n)>>(ptr, n);
             ptr += sizeof(n);
-            *reinterpret_cast<std::decay_t<decltype(f)> *>(ptr) = f;
+            storeUnaligned<std::decay_t<decltype(f)>>(ptr, f);
             ptr += sizeof(f);
-            *reinterpret_cast<std::decay_t<decltype(d)> *>(ptr) = d;
+            storeUnaligned<std::decay_t<decltype(d)>>(ptr, d);
             ptr += sizeof(d);
-            assertm(ptr - data.data.get() == TOTAL_FIELDS_SIZE,
+            assertm(ptr - buffer.data() == static_cast<ptrdiff_t>(serializedSize()),
                     "Some fields aren't be serialized yet");
 
-            return data;
+            return ptr - buffer.data();
         }
 
-        void deserialize(const SerializedData& data) override
+        void deserializeFrom(std::span<const SerializedData::Memory> data) override
         {
-            assertm(data.size > 0 && data.data, "Serialized data is empty");
+            assertm(!data.empty() && data.data(), "Serialized data is empty");
 
-            const auto *ptr = data.data.get();
+            const auto *ptr = data.data();
 
-            n = *reinterpret_cast<const std::decay_t<decltype(n)> *>(ptr);
+            n = loadUnaligned<std::decay_t<decltype(n)>>(ptr);
             ptr += sizeof(n);
-            f = *reinterpret_cast<const std::decay_t<decltype(f)> *>(ptr);
+            f = loadUnaligned<std::decay_t<decltype(f)>>(ptr);
             ptr += sizeof(f);
-            d = *reinterpret_cast<const std::decay_t<decltype(d)> *>(ptr);
+            d = loadUnaligned<std::decay_t<decltype(d)>>(ptr);
             ptr += sizeof(d);
-            assertm(ptr - data.data.get() == data.size,
+            assertm(ptr - data.data() == data.size(),
                     "Some fields aren't be deserialized yet");
         }
     };
@@ -94,6 +276,8 @@ namespace
         char c;
         std::string s;
 
+        static constexpr auto fields = std::tuple{&Struct_2::n, &Struct_2::c, &Struct_2::s};
+
         Struct_2() = default;
 
         Struct_2(std::decay_t<decltype(n)> p_n,
@@ -105,53 +289,53 @@ namespace
         ~Struct_2() override = default;
 
         [[nodiscard]]
-        SerializedData serialize() const override
+        size_t serializedSize() const override
         {
-            const size_t TOTAL_FIELDS_SIZE =
-                sizeof(n) + sizeof(c) + sizeof(decltype(s.size())) + s.size();
-            SerializedData data =
-            {
-                TOTAL_FIELDS_SIZE,
-                std::make_unique<SerializedData::Memory[]>(TOTAL_FIELDS_SIZE)
-            };
-            auto *ptr = data.data.get();
+            return sizeof(n) + sizeof(c) + sizeof(decltype(s.size())) + s.size();
+        }
+
+        size_t serializeInto(std::span<SerializedData::Memory> buffer) const override
+        {
+            assertm(buffer.size() >= serializedSize(), "Buffer is too small");
+
+            auto *ptr = buffer.data();
 
-            *reinterpret_cast<std::decay_t<decltype(n)> *>(ptr) = n;
+            storeUnaligned<std::decay_t<decltype(n)>>(ptr, n);
             ptr += sizeof(n);
-            *reinterpret_cast<std::decay_t<decltype(c)> *>(ptr) = c;
+            storeUnaligned<std::decay_t<decltype(c)>>(ptr, c);
             ptr += sizeof(c);
 
             using StringSize_t = std::decay_t<decltype(s.size())>;
 
-            *reinterpret_cast<StringSize_t *>(ptr) = s.size();
+            storeUnaligned<StringSize_t>(ptr, s.size());
             ptr += sizeof(StringSize_t);
 
             for (auto c : s)
             {
-                *reinterpret_cast<std::decay_t<decltype(c)> *>(ptr) = c;
+                storeUnaligned<std::decay_t<decltype(c)>>(ptr, c);
                 ptr += sizeof(c);
             }
 
-            assertm(ptr - data.data.get() == data.size,
+            assertm(ptr - buffer.data() == static_cast<ptrdiff_t>(serializedSize()),
                     "Some fields aren't be serialized yet");
 
-            return data;
+            return ptr - buffer.data();
         }
 
-        void deserialize(const SerializedData& data) override
+        void deserializeFrom(std::span<const SerializedData::Memory> data) override
         {
-            assertm(data.size > 0 && data.data, "Serialized data is empty");
+            assertm(!data.empty() && data.data(), "Serialized data is empty");
 
-            const auto *ptr = data.data.get();
+            const auto *ptr = data.data();
 
-            n = *reinterpret_cast<const std::decay_t<decltype(n)> *>(ptr);
+            n = loadUnaligned<std::decay_t<decltype(n)>>(ptr);
             ptr += sizeof(n);
-            c = *reinterpret_cast<const std::decay_t<decltype(c)> *>(ptr);
+            c = loadUnaligned<std::decay_t<decltype(c)>>(ptr);
             ptr += sizeof(c);
 
             using StringSize_t = std::decay_t<decltype(s.size())>;
 
-            StringSize_t len = *reinterpret_cast<const StringSize_t *>(ptr);
+            StringSize_t len = loadUnaligned<StringSize_t>(ptr);
 
             ptr += sizeof(len);
             s.reserve(len);
@@ -160,11 +344,11 @@ namespace
             {
                 using Value_t = std::decay_t<decltype(s)>::value_type;
 
-                s.push_back(*reinterpret_cast<const Value_t *>(ptr));
+                s.push_back(loadUnaligned<Value_t>(ptr));
                 ptr += sizeof(Value_t);
             }
 
-            assertm(ptr - data.data.get() == data.size,
+            assertm(ptr - data.data() == data.size(),
                     "Some fields aren't deserialized yet");
         }
     };
@@ -176,6 +360,8 @@ namespace
         short s;
         std::map<int, std::string> m;
 
+        static constexpr auto fields = std::tuple{&Struct_3::s, &Struct_3::m};
+
         Struct_3() = default;
 
         Struct_3(std::decay_t<decltype(s)> p_s,
@@ -186,7 +372,7 @@ namespace
         ~Struct_3() override = default;
 
         [[nodiscard]]
-        SerializedData serialize() const override
+        size_t serializedSize() const override
         {
             size_t total_fields_size = sizeof(s) + sizeof(decltype(m.size()));
 
@@ -197,58 +383,60 @@ namespace
                 total_fields_size += value.size();
             }
 
-            SerializedData data
-            {
-                total_fields_size,
-                std::make_unique<SerializedData::Memory[]>(total_fields_size)
-            };
-            auto *ptr = data.data.get();
+            return total_fields_size;
+        }
+
+        size_t serializeInto(std::span<SerializedData::Memory> buffer) const override
+        {
+            assertm(buffer.size() >= serializedSize(), "Buffer is too small");
+
+            auto *ptr = buffer.data();
 
-            *reinterpret_cast<std::decay_t<decltype(s)> *>(ptr) = s;
+            storeUnaligned<std::decay_t<decltype(s)>>(ptr, s);
             ptr += sizeof(s);
 
             using MapSize_t = std::decay_t<decltype(m.size())>;
 
-            *reinterpret_cast<MapSize_t *>(ptr) = m.size();
+            storeUnaligned<MapSize_t>(ptr, m.size());
             ptr += sizeof(MapSize_t);
 
             for (const auto& [key, value] : m)
             {
                 using Key_t = std::decay_t<decltype(key)>;
 
-                *reinterpret_cast<Key_t *>(ptr) = key;
+                storeUnaligned<Key_t>(ptr, key);
                 ptr += sizeof(Key_t);
 
                 using StringSize_t = std::decay_t<decltype(value.size())>;
 
-                *reinterpret_cast<StringSize_t *>(ptr) = value.size();
+                storeUnaligned<StringSize_t>(ptr, value.size());
                 ptr += sizeof(StringSize_t);
 
                 for (auto c : value)
                 {
-                    *reinterpret_cast<std::decay_t<decltype(c)> *>(ptr) = c;
+                    storeUnaligned<std::decay_t<decltype(c)>>(ptr, c);
                     ptr += sizeof(c);
                 }
             }
 
-            assertm(ptr - data.data.get() == data.size,
+            assertm(ptr - buffer.data() == static_cast<ptrdiff_t>(serializedSize()),
                     "Some fields aren't be serialized yet");
 
-            return data;
+            return ptr - buffer.data();
         }
 
-        void deserialize(const SerializedData& data) override
+        void deserializeFrom(std::span<const SerializedData::Memory> data) override
         {
-            assertm(data.size > 0 && data.data, "Serialized data is empty");
+            assertm(!data.empty() && data.data(), "Serialized data is empty");
 
-            const auto *ptr = data.data.get();
+            const auto *ptr = data.data();
 
-            s = *reinterpret_cast<const std::decay_t<decltype(s)> *>(ptr);
+            s = loadUnaligned<std::decay_t<decltype(s)>>(ptr);
             ptr += sizeof(s);
 
             using MapSize_t = std::decay_t<decltype(m.size())>;
 
-            MapSize_t size = *reinterpret_cast<const MapSize_t *>(ptr);
+            MapSize_t size = loadUnaligned<MapSize_t>(ptr);
 
             ptr += sizeof(size);
 
@@ -257,14 +445,14 @@ namespace
                 using Map_t = std::decay_t<decltype(m)>;
                 using Key_t = Map_t::key_type;
 
-                Key_t key = *reinterpret_cast<const Key_t *>(ptr);
+                Key_t key = loadUnaligned<Key_t>(ptr);
 
                 ptr += sizeof(key);
 
                 using Value_t = Map_t::mapped_type;
                 using StringSize_t = Value_t::size_type;
 
-                StringSize_t len = *reinterpret_cast<const StringSize_t *>(ptr);
+                StringSize_t len = loadUnaligned<StringSize_t>(ptr);
 
                 ptr += sizeof(len);
 
@@ -276,108 +464,5343 @@ namespace
                 {
                     using StringValue_t = std::decay_t<decltype(value)>::value_type;
 
-                    value.push_back(*reinterpret_cast<const StringValue_t *>(ptr));
+                    value.push_back(loadUnaligned<StringValue_t>(ptr));
                     ptr += sizeof(StringValue_t);
                 }
 
                 m.emplace(key, std::move(value));
             }
 
-            assertm(ptr - data.data.get() == data.size,
+            assertm(ptr - data.data() == data.size(),
                     "Some fields aren't deserialized yet");
         }
     };
-}
 
-TEST(SerializationTest, TestStruct_1)
-{
-    using SerializedData = Struct_1::SerializedData;
+    /* Batch of objects of a closed set of SerDes types, stored inline in a
+       vector of variants instead of one heap allocation per object. Calls
+       are dispatched statically on the variant index and qualified with the
+       concrete type, so no virtual call is made. Wire format : a uint64_t
+       count then for every object a uint8_t type tag (index of its type in
+       Structs), a uint64_t size and the serialized object */
+    template <typename... Structs>
+        requires (std::derived_from<Structs, SerDes> && ...) && (sizeof...(Structs) <= UINT8_MAX)
+    class SerDesBatch
+    {
+    public :
+        using Variant_t = std::variant<Structs...>;
+        using Tag_t = uint8_t;
+        using Size_t = uint64_t;
 
-    Struct_1 structToSerialize{42, 84.5, 245.2};
-    SerializedData data = structToSerialize.serialize();
-    Struct_1 structToDeserialize;
+        [[nodiscard]]
+        inline size_t size() const noexcept { return _objects.size(); }
 
-    structToDeserialize.deserialize(data);
-    EXPECT_EQ(structToDeserialize.n, 42);
-    EXPECT_EQ(structToDeserialize.f, 84.5);
-    EXPECT_EQ(structToDeserialize.d, 245.2);
-}
+        [[nodiscard]]
+        inline bool empty() const noexcept { return _objects.empty(); }
 
-TEST(SerializationTest, TestStruct_2)
-{
-    using SerializedData = Struct_2::SerializedData;
+        [[nodiscard]]
+        inline const Variant_t& operator[](size_t n) const noexcept { return _objects[n]; }
 
-    Struct_2 structToSerialize{42, 'a', "Hello World !"};
-    SerializedData data = structToSerialize.serialize();
-    Struct_2 structToDeserialize;
+        [[nodiscard]]
+        inline Variant_t& operator[](size_t n) noexcept { return _objects[n]; }
 
-    structToDeserialize.deserialize(data);
-    EXPECT_EQ(structToDeserialize.n, 42);
-    EXPECT_EQ(structToDeserialize.c, 'a');
-    EXPECT_EQ(structToDeserialize.s, "Hello World !");
-}
+        [[nodiscard]]
+        inline auto begin() const noexcept { return _objects.begin(); }
 
-TEST(SerializationTest, TestStruct_3)
-{
-    using SerializedData = Struct_3::SerializedData;
+        [[nodiscard]]
+        inline auto end() const noexcept { return _objects.end(); }
 
-    Struct_3 structToSerialize{3, {{8, "abcd" }, {2, "efgh"}, {253, "AETOP"}}};
-    SerializedData data = structToSerialize.serialize();
-    Struct_3 structToDeserialize;
+        inline void clear() noexcept { _objects.clear(); }
 
-    structToDeserialize.deserialize(data);
-    EXPECT_EQ(structToDeserialize.s, 3);
-    EXPECT_THAT(structToDeserialize.m,
-                ElementsAre(Pair(2, "efgh"), Pair(8, "abcd"), Pair(253, "AETOP")));
-}
+        inline void reserve(size_t capacity) { _objects.reserve(capacity); }
 
-TEST(SerializationTest, TestAllStructsWithVirtualisation)
-{
-    using SerializedData = SerDes::SerializedData;
+        template <typename Struct, typename... Args>
+        Struct& emplace_back(Args&&... args)
+        {
+            return std::get<Struct>(_objects.emplace_back(std::in_place_type<Struct>,
+                                                          std::forward<Args>(args)...));
+        }
 
-    std::array<std::unique_ptr<SerDes>, 3> serializers;
+        [[nodiscard]]
+        size_t serializedSize() const
+        {
+            size_t totalSize = sizeof(Size_t);
 
-    serializers[0] = std::make_unique<Struct_1>(
-        10, 21.0, 57.7);
-    serializers[1] = std::make_unique<Struct_2>(
-        411, 'W', "WaWaZa");
-    serializers[2] = std::make_unique<Struct_3>(
-        15, std::map<int, std::string>{{1000, "ASD"}, {478, "GgH"}});
+            for (const auto& object : _objects)
+            {
+                totalSize += sizeof(Tag_t) + sizeof(Size_t) + objectSize(object);
+            }
 
-    std::array<SerializedData, serializers.size()> datas;
+            return totalSize;
+        }
 
-    for (uint32_t n = 0; n < serializers.size(); ++n)
+        // Appends to buffer in two passes like serializeAll(), returns the offset of the batch
+        size_t serialize(SerDes::OutputBuffer& buffer) const
+        {
+            size_t offset = buffer.size();
+            auto *ptr = buffer.append(serializedSize()).data();
+            Size_t count = _objects.size();
+
+            std::memcpy(ptr, &count, sizeof(count));
+            ptr += sizeof(count);
+
+            for (const auto& object : _objects)
+            {
+                Tag_t tag = static_cast<Tag_t>(object.index());
+                Size_t size = objectSize(object);
+
+                std::memcpy(ptr, &tag, sizeof(tag));
+                ptr += sizeof(tag);
+                std::memcpy(ptr, &size, sizeof(size));
+                ptr += sizeof(size);
+                std::visit([&ptr, size](const auto& concreteObject)
+                {
+                    using Struct_t = std::remove_cvref_t<decltype(concreteObject)>;
+
+                    concreteObject.Struct_t::serializeInto({ptr, size});
+                }, object);
+                ptr += size;
+            }
+
+            return offset;
+        }
+
+        // Replaces the content of the batch, returns the size of the batch in data
+        size_t deserializeFrom(std::span<const SerDes::SerializedData::Memory> data)
+        {
+            auto remaining = data;
+            Size_t count = read<Size_t>(remaining);
+
+            _objects.clear();
+            _objects.reserve(std::min<Size_t>(count, remaining.size() / (sizeof(Tag_t) + sizeof(Size_t))));
+
+            for (Size_t n = 0; n < count; ++n)
+            {
+                Tag_t tag = read<Tag_t>(remaining);
+                Size_t size = read<Size_t>(remaining);
+
+                if (tag >= sizeof...(Structs))
+                {
+                    throw std::runtime_error("unknown object type in batch");
+                }
+
+                if (size > remaining.size())
+                {
+                    throw std::runtime_error("truncated batch");
+                }
+
+                DESERIALIZERS[tag](_objects, remaining.first(size));
+                remaining = remaining.subspan(size);
+            }
+
+            return data.size() - remaining.size();
+        }
+
+    private :
+        using Deserializer_t = void (*)(std::vector<Variant_t>&,
+                                        std::span<const SerDes::SerializedData::Memory>);
+
+        // Indexed by type tag
+        static constexpr auto DESERIALIZERS = []<size_t... Tags>(std::index_sequence<Tags...>)
+        {
+            return std::array<Deserializer_t, sizeof...(Tags)>
+            {
+                [](std::vector<Variant_t>& objects, std::span<const SerDes::SerializedData::Memory> data)
+                {
+                    using Struct_t = std::variant_alternative_t<Tags, Variant_t>;
+
+                    std::get<Tags>(objects.emplace_back(std::in_place_index<Tags>))
+                        .Struct_t::deserializeFrom(data);
+                }...
+            };
+        }(std::index_sequence_for<Structs...>());
+
+        std::vector<Variant_t> _objects;
+
+        [[nodiscard]]
+        static size_t objectSize(const Variant_t& object)
+        {
+            return std::visit([](const auto& concreteObject)
+            {
+                using Struct_t = std::remove_cvref_t<decltype(concreteObject)>;
+
+                return concreteObject.Struct_t::serializedSize();
+            }, object);
+        }
+
+        template <typename T>
+        [[nodiscard]]
+        static T read(std::span<const SerDes::SerializedData::Memory>& data)
+        {
+            T value;
+
+            if (data.size() < sizeof(value))
+            {
+                throw std::runtime_error("truncated batch");
+            }
+
+            std::memcpy(&value, data.data(), sizeof(value));
+            data = data.subspan(sizeof(value));
+
+            return value;
+        }
+    };
+
+    // Struct listing its fields as a tuple of member pointers
+    template <typename T>
+    concept HasSchema = requires { std::tuple_size<decltype(T::fields)>::value; };
+
+    // Wire encoding of the schema generated code
+    enum class Encoding
     {
-        datas[n] = serializers[n]->serialize();
-    }
+        // Full width integers and size_t lengths, same bytes than SerDes::serialize()
+        FixedWidth,
+        // Integers and lengths as LEB128 varints, signed ones zigzag encoded first
+        Compact
+    };
 
-    std::array<std::unique_ptr<SerDes>, datas.size()> deserializers;
+    /* Serialization code generated at compile time from the fields tuple of
+       a struct : each field is (de)serialized by the FieldCodec of its type,
+       resolved statically and fully inlined, without any virtual dispatch.
+       Reads never go past end, they throw on truncated or corrupted data */
+    template <typename T, Encoding E = Encoding::FixedWidth>
+    struct FieldCodec;
 
-    deserializers[0] = std::make_unique<Struct_1>();
-    deserializers[1] = std::make_unique<Struct_2>();
-    deserializers[2] = std::make_unique<Struct_3>();
+    // Floating point and single byte values are always written as is
+    template <typename T, Encoding E>
+        requires std::is_arithmetic_v<T> &&
+                 (E == Encoding::FixedWidth || !std::is_integral_v<T> || sizeof(T) == 1)
+    struct FieldCodec<T, E>
+    {
+        static constexpr size_t size(const T&) noexcept { return sizeof(T); }
 
-    for (uint32_t n = 0; n < datas.size(); ++n)
+        static void write(std::byte *&ptr, const T& value) noexcept
+        {
+            std::memcpy(ptr, &value, sizeof(T));
+            ptr += sizeof(T);
+        }
+
+        static void read(const std::byte *&ptr, const std::byte *end, T& value)
+        {
+            if (end - ptr < static_cast<ptrdiff_t>(sizeof(T)))
+            {
+                throw std::runtime_error("truncated field");
+            }
+
+            std::memcpy(&value, ptr, sizeof(T));
+            ptr += sizeof(T);
+        }
+    };
+
+    /* 7 bits per byte, least significant group first, the high bit telling
+       whether another byte follows. Signed values are zigzag encoded
+       (0, -1, 1, -2... become 0, 1, 2, 3...) so small negative values stay short */
+    template <typename T>
+        requires std::is_integral_v<T> && (sizeof(T) > 1)
+    struct FieldCodec<T, Encoding::Compact>
     {
-        deserializers[n]->deserialize(datas[n]);
-    }
+        using Unsigned_t = std::make_unsigned_t<T>;
 
-    const auto& deserializedStruct_1 = static_cast<Struct_1&>(*deserializers[0]);
+        static constexpr size_t size(const T& value) noexcept
+        {
+            return (std::bit_width(static_cast<Unsigned_t>(zigzag(value) | 1)) + 6) / 7;
+        }
 
-    EXPECT_EQ(deserializedStruct_1.n, 10);
-    EXPECT_EQ(deserializedStruct_1.f, 21.0);
-    EXPECT_EQ(deserializedStruct_1.d, 57.7);
+        static void write(std::byte *&ptr, const T& value) noexcept
+        {
+            Unsigned_t encoded = zigzag(value);
 
-    const auto& deserializedStruct_2 = static_cast<Struct_2&>(*deserializers[1]);
+            while (encoded >= 0x80)
+            {
+                *ptr++ = static_cast<std::byte>(encoded | 0x80);
+                encoded >>= 7;
+            }
 
-    EXPECT_EQ(deserializedStruct_2.n, 411);
-    EXPECT_EQ(deserializedStruct_2.c, 'W');
-    EXPECT_EQ(deserializedStruct_2.s, "WaWaZa");
+            *ptr++ = static_cast<std::byte>(encoded);
+        }
 
-    const auto& deserializedStruct_3 = static_cast<Struct_3&>(*deserializers[2]);
+        // Values below 2^14 (1 or 2 bytes) are decoded without any loop
+        static void read(const std::byte *&ptr, const std::byte *end, T& value)
+        {
+            if (end - ptr < 2)
+            {
+                value = unzigzag(readLongVarint(ptr, end));
+                return;
+            }
 
-    EXPECT_EQ(deserializedStruct_3.s, 15);
-    EXPECT_THAT(deserializedStruct_3.m, ElementsAre(Pair(478, "GgH"), Pair(1000, "ASD")));
+            // First byte in the low bits whatever the endianness
+            uint16_t word = loadUnaligned<uint16_t>(ptr);
+
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                word = static_cast<uint16_t>((word << 8) | (word >> 8));
+            }
+
+            if ((word & 0x8080) == 0x8080)
+            {
+                value = unzigzag(readLongVarint(ptr, end));
+                return;
+            }
+
+            // The second byte is kept only when the first one has its continuation bit
+            const uint16_t continued = (word >> 7) & 1;
+            const uint16_t secondMask = static_cast<uint16_t>(-continued) & 0x3F80;
+
+            ptr += 1 + continued;
+            value = unzigzag(static_cast<Unsigned_t>((word & 0x7F) | ((word >> 1) & secondMask)));
+        }
+
+    private :
+        // 10 bytes for 64 bits values
+        static constexpr ptrdiff_t MAX_VARINT_BYTES = (sizeof(T) * CHAR_BIT + 6) / 7;
+
+        static constexpr Unsigned_t zigzag(T value) noexcept
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                return (static_cast<Unsigned_t>(value) << 1) ^
+                    static_cast<Unsigned_t>(value >> (sizeof(T) * CHAR_BIT - 1));
+            }
+            else
+            {
+                return value;
+            }
+        }
+
+        static constexpr T unzigzag(Unsigned_t encoded) noexcept
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                return static_cast<T>((encoded >> 1) ^ (~(encoded & 1) + 1));
+            }
+            else
+            {
+                return encoded;
+            }
+        }
+
+        static Unsigned_t readLongVarint(const std::byte *&ptr, const std::byte *end)
+        {
+            const std::byte *last = ptr + std::min(end - ptr, MAX_VARINT_BYTES);
+            Unsigned_t encoded = 0;
+
+            for (uint32_t shift = 0; ptr < last; shift += 7)
+            {
+                uint8_t byte = std::to_integer<uint8_t>(*ptr++);
+
+                encoded |= static_cast<Unsigned_t>(byte & 0x7F) << shift;
+
+                if (!(byte & 0x80))
+                {
+                    return encoded;
+                }
+            }
+
+            throw std::runtime_error("truncated or too long varint");
+        }
+    };
+
+    template <Encoding E>
+    struct FieldCodec<std::string, E>
+    {
+        using Size_t = std::string::size_type;
+
+        static size_t size(const std::string& value) noexcept
+        {
+            return FieldCodec<Size_t, E>::size(value.size()) + value.size();
+        }
+
+        static void write(std::byte *&ptr, const std::string& value) noexcept
+        {
+            FieldCodec<Size_t, E>::write(ptr, value.size());
+            std::memcpy(ptr, value.data(), value.size());
+            ptr += value.size();
+        }
+
+        static void read(const std::byte *&ptr, const std::byte *end, std::string& value)
+        {
+            Size_t len;
+
+            FieldCodec<Size_t, E>::read(ptr, end, len);
+
+            if (len > static_cast<size_t>(end - ptr))
+            {
+                throw std::runtime_error("truncated field");
+            }
+
+            value.assign(reinterpret_cast<const char *>(ptr), len);
+            ptr += len;
+        }
+    };
+
+    template <typename Key, typename Value, Encoding E>
+    struct FieldCodec<std::map<Key, Value>, E>
+    {
+        using Map_t = std::map<Key, Value>;
+        using Size_t = typename Map_t::size_type;
+
+        static size_t size(const Map_t& map) noexcept
+        {
+            size_t totalSize = FieldCodec<Size_t, E>::size(map.size());
+
+            for (const auto& [key, value] : map)
+            {
+                totalSize += FieldCodec<Key, E>::size(key) + FieldCodec<Value, E>::size(value);
+            }
+
+            return totalSize;
+        }
+
+        static void write(std::byte *&ptr, const Map_t& map) noexcept
+        {
+            FieldCodec<Size_t, E>::write(ptr, map.size());
+
+            for (const auto& [key, value] : map)
+            {
+                FieldCodec<Key, E>::write(ptr, key);
+                FieldCodec<Value, E>::write(ptr, value);
+            }
+        }
+
+        static void read(const std::byte *&ptr, const std::byte *end, Map_t& map)
+        {
+            Size_t size;
+
+            FieldCodec<Size_t, E>::read(ptr, end, size);
+            map.clear();
+
+            for (Size_t n = 0; n < size; ++n)
+            {
+                Key key;
+                Value value;
+
+                FieldCodec<Key, E>::read(ptr, end, key);
+                FieldCodec<Value, E>::read(ptr, end, value);
+                // Keys are written sorted, so each one goes at the end
+                map.emplace_hint(map.end(), std::move(key), std::move(value));
+            }
+        }
+    };
+
+    // Nested structs are written field by field, like the top-level one
+    template <HasSchema T, Encoding E>
+    struct FieldCodec<T, E>
+    {
+        template <typename Func>
+        static void forEachField(Func&& func)
+        {
+            std::apply([&func](auto... fieldPtrs) { (func(fieldPtrs), ...); }, T::fields);
+        }
+
+        static size_t size(const T& object) noexcept
+        {
+            size_t totalSize = 0;
+
+            forEachField([&](auto fieldPtr)
+            {
+                totalSize += FieldCodec<FieldType_t<decltype(fieldPtr)>, E>::size(object.*fieldPtr);
+            });
+
+            return totalSize;
+        }
+
+        static void write(std::byte *&ptr, const T& object) noexcept
+        {
+            forEachField([&](auto fieldPtr)
+            {
+                FieldCodec<FieldType_t<decltype(fieldPtr)>, E>::write(ptr, object.*fieldPtr);
+            });
+        }
+
+        static void read(const std::byte *&ptr, const std::byte *end, T& object)
+        {
+            forEachField([&](auto fieldPtr)
+            {
+                FieldCodec<FieldType_t<decltype(fieldPtr)>, E>::read(ptr, end, object.*fieldPtr);
+            });
+        }
+
+    private :
+        template <typename FieldPtr>
+        struct FieldType;
+
+        template <typename Field, typename Class>
+        struct FieldType<Field Class::*>
+        {
+            using type = Field;
+        };
+
+        template <typename FieldPtr>
+        using FieldType_t = typename FieldType<FieldPtr>::type;
+    };
+
+    template <Encoding E = Encoding::FixedWidth, HasSchema T>
+    [[nodiscard]]
+    SerDes::SerializedData serializeWithSchema(const T& object)
+    {
+        using SerializedData = SerDes::SerializedData;
+
+        size_t totalFieldsSize = FieldCodec<T, E>::size(object);
+        SerializedData data
+        {
+            totalFieldsSize,
+            std::make_unique_for_overwrite<SerializedData::Memory[]>(totalFieldsSize)
+        };
+        auto *ptr = data.data.get();
+
+        FieldCodec<T, E>::write(ptr, object);
+        assertm(ptr - data.data.get() == static_cast<ptrdiff_t>(data.size),
+                "Some fields aren't be serialized yet");
+
+        return data;
+    }
+
+    template <Encoding E = Encoding::FixedWidth, HasSchema T>
+    void deserializeWithSchema(T& object, const SerDes::SerializedData& data)
+    {
+        assertm(data.size > 0 && data.data, "Serialized data is empty");
+
+        const auto *ptr = data.data.get();
+
+        FieldCodec<T, E>::read(ptr, ptr + data.size, object);
+        assertm(ptr - data.data.get() == static_cast<ptrdiff_t>(data.size),
+                "Some fields aren't deserialized yet");
+    }
+
+    // Struct whose fields are all arithmetic, a batch of them can be stored column by column
+    template <typename T, size_t... Indexes>
+    consteval bool hasArithmeticFields(std::index_sequence<Indexes...>)
+    {
+        return (std::is_arithmetic_v<std::remove_cvref_t<
+                    decltype(std::declval<const T&>().*std::get<Indexes>(T::fields))>> && ...);
+    }
+
+    template <typename T>
+    concept Columnar = HasSchema<T> &&
+        hasArithmeticFields<T>(std::make_index_sequence<std::tuple_size_v<decltype(T::fields)>>());
+
+    [[nodiscard]]
+    constexpr size_t alignUp(size_t offset, size_t alignment) noexcept
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    /* Columnar batch format (struct of arrays) : a uint64_t count followed by
+       one contiguous array per field, in the order of the fields tuple, each
+       padded to 8 bytes. Batches start on 8 bytes boundaries of the output
+       buffer, so that every column stays aligned. Values are copied
+       with fixed-size memcpy inlined by the compiler, without any virtual
+       call per object, and each column can be processed as a plain array */
+    constexpr size_t COLUMN_ALIGNMENT = 8;
+
+    template <typename T, typename FieldPtr>
+    using ColumnType_t = std::remove_cvref_t<decltype(std::declval<const T&>().*std::declval<FieldPtr>())>;
+
+    // Size of a column including its padding
+    template <typename Field>
+    [[nodiscard]]
+    constexpr size_t columnSize(size_t count) noexcept
+    {
+        return alignUp(count * sizeof(Field), COLUMN_ALIGNMENT);
+    }
+
+    // Bytes of one object over all the columns, without padding
+    template <Columnar T>
+    constexpr size_t COLUMNAR_ROW_SIZE = std::apply([](auto... fieldPtrs)
+    {
+        return (sizeof(ColumnType_t<T, decltype(fieldPtrs)>) + ...);
+    }, T::fields);
+
+    template <Columnar T>
+    [[nodiscard]]
+    constexpr size_t columnarSize(size_t count) noexcept
+    {
+        return std::apply([count](auto... fieldPtrs)
+        {
+            return sizeof(uint64_t) + (columnSize<ColumnType_t<T, decltype(fieldPtrs)>>(count) + ...);
+        }, T::fields);
+    }
+
+    /* Calls func(n, fieldPtr, columnPtr) for every field of every object
+       of the batch, columnPtr pointing to the value in its column. Objects
+       are visited in a single pass, the columns being read or written as
+       parallel sequential streams */
+    template <Columnar T, typename Byte, typename Func>
+    void forEachColumnValue(Byte *columns, size_t count, Func&& func)
+    {
+        std::array<Byte *, std::tuple_size_v<decltype(T::fields)>> columnPtrs;
+
+        std::apply([&](auto... fieldPtrs)
+        {
+            size_t index = 0;
+
+            ((columnPtrs[index++] = columns,
+              columns += columnSize<ColumnType_t<T, decltype(fieldPtrs)>>(count)), ...);
+        }, T::fields);
+
+        for (size_t n = 0; n < count; ++n)
+        {
+            std::apply([&](auto... fieldPtrs)
+            {
+                size_t index = 0;
+
+                (func(n, fieldPtrs,
+                      columnPtrs[index++] + n * sizeof(ColumnType_t<T, decltype(fieldPtrs)>)), ...);
+            }, T::fields);
+        }
+    }
+
+    // Appends the batch to buffer, returns its offset in it
+    template <Columnar T>
+    size_t serializeColumnar(std::span<const T> objects, SerDes::OutputBuffer& buffer)
+    {
+        std::ranges::fill(buffer.append(alignUp(buffer.size(), COLUMN_ALIGNMENT) - buffer.size()),
+                          std::byte(0));
+
+        size_t offset = buffer.size();
+        auto bytes = buffer.append(columnarSize<T>(objects.size()));
+        uint64_t count = objects.size();
+        auto *columns = bytes.data() + sizeof(count);
+
+        std::memcpy(bytes.data(), &count, sizeof(count));
+
+        // Zeroes the padding : the last 8 bytes of each column, values overwrite the rest
+        if (count > 0)
+        {
+            std::apply([&](auto... fieldPtrs)
+            {
+                auto *columnEnd = columns;
+
+                ((columnEnd += columnSize<ColumnType_t<T, decltype(fieldPtrs)>>(count),
+                  std::memset(columnEnd - COLUMN_ALIGNMENT, 0, COLUMN_ALIGNMENT)), ...);
+            }, T::fields);
+        }
+
+        forEachColumnValue<T>(columns, count, [&objects](size_t n, auto fieldPtr, std::byte *value)
+        {
+            std::memcpy(value, &(objects[n].*fieldPtr), sizeof(objects[n].*fieldPtr));
+        });
+
+        return offset;
+    }
+
+    // Replaces the content of objects with the batch, returns its size in data
+    template <Columnar T>
+    size_t deserializeColumnar(std::span<const SerDes::SerializedData::Memory> data, std::vector<T>& objects)
+    {
+        if (data.size() < sizeof(uint64_t))
+        {
+            throw std::runtime_error("truncated batch");
+        }
+
+        uint64_t count = loadUnaligned<uint64_t>(data.data());
+
+        // Count checked first so that columnarSize() can't overflow
+        if (count > (data.size() - sizeof(count)) / COLUMNAR_ROW_SIZE<T> ||
+            data.size() < columnarSize<T>(count))
+        {
+            throw std::runtime_error("truncated batch");
+        }
+
+        objects.resize(count);
+        forEachColumnValue<T>(data.data() + sizeof(count), count,
+                              [&objects](size_t n, auto fieldPtr, const std::byte *value)
+        {
+            std::memcpy(&(objects[n].*fieldPtr), value, sizeof(objects[n].*fieldPtr));
+        });
+
+        return columnarSize<T>(count);
+    }
+
+    // Reads the fields of a serialized buffer in order, without copying strings
+    class FieldReader
+    {
+    public :
+        FieldReader(const std::byte *begin, const std::byte *end) noexcept
+            : _ptr(begin), _end(end)
+        { }
+
+        [[nodiscard]]
+        inline const std::byte *position() const noexcept { return _ptr; }
+
+        [[nodiscard]]
+        inline size_t remaining() const noexcept { return static_cast<size_t>(_end - _ptr); }
+
+        template <typename T>
+            requires std::is_arithmetic_v<T>
+        [[nodiscard]]
+        T read()
+        {
+            if (remaining() < sizeof(T))
+            {
+                throw std::runtime_error("truncated field");
+            }
+
+            T value = loadUnaligned<T>(_ptr);
+
+            _ptr += sizeof(T);
+
+            return value;
+        }
+
+        [[nodiscard]]
+        std::string_view readString()
+        {
+            auto len = read<std::string::size_type>();
+
+            if (len > remaining())
+            {
+                throw std::runtime_error("truncated field");
+            }
+
+            std::string_view value(reinterpret_cast<const char *>(_ptr), len);
+
+            _ptr += len;
+
+            return value;
+        }
+
+    private :
+        const std::byte *_ptr;
+        const std::byte *_end;
+    };
+
+    /* Serialized std::map<Key, std::string> read in place : entries are
+       decoded one by one while iterating, values are views into the
+       serialized buffer. Decoding throws if the buffer is truncated. Keys are serialized sorted, so find() stops as
+       soon as it passes the searched key. Nothing is allocated */
+    template <typename Key>
+    class StringMapView
+    {
+    public :
+        class Iterator
+        {
+        public :
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<Key, std::string_view>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const value_type *;
+            using reference = const value_type&;
+
+            Iterator() = default;
+
+            Iterator(FieldReader reader, size_t remaining)
+                : _reader(reader), _remaining(remaining)
+            {
+                decode();
+            }
+
+            [[nodiscard]]
+            reference operator*() const noexcept { return _entry; }
+
+            [[nodiscard]]
+            pointer operator->() const noexcept { return &_entry; }
+
+            Iterator& operator++()
+            {
+                --_remaining;
+                decode();
+
+                return *this;
+            }
+
+            Iterator operator++(int)
+            {
+                Iterator it = *this;
+
+                ++(*this);
+
+                return it;
+            }
+
+            [[nodiscard]]
+            bool operator==(const Iterator& other) const noexcept
+            {
+                return _remaining == other._remaining;
+            }
+
+        private :
+            FieldReader _reader{nullptr, nullptr};
+            size_t _remaining = 0;
+            value_type _entry{};
+
+            void decode()
+            {
+                if (_remaining > 0)
+                {
+                    _entry.first = _reader.read<Key>();
+                    _entry.second = _reader.readString();
+                }
+            }
+        };
+
+        using value_type = typename Iterator::value_type;
+        using const_iterator = Iterator;
+        using Size_t = typename std::map<Key, std::string>::size_type;
+
+        StringMapView() = default;
+
+        // reader must be positioned on the entries count. Entries aren't
+        // skipped, so the map must be the last field of the buffer
+        explicit StringMapView(FieldReader& reader)
+            : _size(reader.read<Size_t>()),
+              _entries(reader)
+        {
+            // Each entry takes at least a key and a string length
+            if (_size > reader.remaining() / (sizeof(Key) + sizeof(std::string::size_type)))
+            {
+                throw std::runtime_error("truncated field");
+            }
+        }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept { return _size; }
+
+        [[nodiscard]]
+        inline bool empty() const noexcept { return _size == 0; }
+
+        [[nodiscard]]
+        Iterator begin() const { return Iterator(_entries, _size); }
+
+        [[nodiscard]]
+        Iterator end() const noexcept { return Iterator(); }
+
+        [[nodiscard]]
+        Iterator find(const Key& key) const
+        {
+            for (auto it = begin(); it != end(); ++it)
+            {
+                if (it->first == key)
+                {
+                    return it;
+                }
+
+                if (key < it->first)
+                {
+                    break;
+                }
+            }
+
+            return end();
+        }
+
+        [[nodiscard]]
+        std::optional<std::string_view> lookup(const Key& key) const
+        {
+            auto it = find(key);
+
+            return it != end() ? std::optional(it->second) : std::nullopt;
+        }
+
+    private :
+        size_t _size = 0;
+        FieldReader _entries{nullptr, nullptr};
+    };
+
+    // Keeps the serialized buffer alive as long as a view into it exists
+    class SerializedView
+    {
+    public :
+        explicit SerializedView(std::shared_ptr<const SerDes::SerializedData> data) noexcept
+            : _data(std::move(data))
+        {
+            assertm(_data && _data->size > 0 && _data->data, "Serialized data is empty");
+        }
+
+    protected :
+        [[nodiscard]]
+        FieldReader reader() const noexcept
+        {
+            const auto *begin = _data->data.get();
+
+            return FieldReader(begin, begin + _data->size);
+        }
+
+    private :
+        std::shared_ptr<const SerDes::SerializedData> _data;
+    };
+
+    // Struct_2 read in place from its serialized data
+    class Struct_2View : public SerializedView
+    {
+    public :
+        // Throws if data is truncated
+        explicit Struct_2View(std::shared_ptr<const SerDes::SerializedData> data)
+            : SerializedView(std::move(data))
+        {
+            FieldReader fieldReader = reader();
+
+            _n = fieldReader.read<int>();
+            _c = fieldReader.read<char>();
+            _s = fieldReader.readString();
+        }
+
+        [[nodiscard]]
+        inline int n() const noexcept { return _n; }
+
+        [[nodiscard]]
+        inline char c() const noexcept { return _c; }
+
+        [[nodiscard]]
+        inline std::string_view s() const noexcept { return _s; }
+
+    private :
+        int _n;
+        char _c;
+        std::string_view _s;
+    };
+
+    // Struct_3 read in place from its serialized data
+    class Struct_3View : public SerializedView
+    {
+    public :
+        // Throws if data is truncated, entries only once decoded
+        explicit Struct_3View(std::shared_ptr<const SerDes::SerializedData> data)
+            : SerializedView(std::move(data))
+        {
+            FieldReader fieldReader = reader();
+
+            _s = fieldReader.read<short>();
+            _m = StringMapView<int>(fieldReader);
+        }
+
+        [[nodiscard]]
+        inline short s() const noexcept { return _s; }
+
+        [[nodiscard]]
+        inline const StringMapView<int>& m() const noexcept { return _m; }
+
+    private :
+        short _s;
+        StringMapView<int> _m;
+    };
+
+    /* LZ77 block codec in the spirit of LZ4, to shrink repetitive payloads
+       (map keys, similar strings) before they hit the disk. A block is the
+       uncompressed size (uint64_t) followed by sequences : a token (literals
+       length in the high 4 bits, match length - 4 in the low ones, 15
+       meaning more length bytes follow, 255 meaning yet another one),
+       the literals, then the match as a uint16_t offset back into the output.
+       The last sequence only has literals. The compressor is a greedy single
+       pass over a hash table of 4 bytes sequences, the decompressor only
+       copies bytes, by chunks of 8 or 16 whenever possible */
+    namespace lz
+    {
+        constexpr size_t MIN_MATCH = 4;
+        constexpr size_t MAX_OFFSET = UINT16_MAX;
+        // Matches stop before the end, where literals can be read safely 8 bytes at a time
+        constexpr size_t LAST_LITERALS = 8;
+        constexpr size_t HASH_BITS = 13;
+        // Room left at the end of the output to copy bytes in chunks
+        constexpr size_t COPY_SLACK = 16;
+
+        [[nodiscard]]
+        inline uint32_t hash(uint32_t sequence) noexcept
+        {
+            return (sequence * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        inline void writeLength(std::byte *&ptr, size_t length) noexcept
+        {
+            for (; length >= 255; length -= 255)
+            {
+                *ptr++ = std::byte(255);
+            }
+
+            *ptr++ = static_cast<std::byte>(length);
+        }
+
+        [[nodiscard]]
+        inline size_t readLength(const std::byte *&ptr, const std::byte *end, size_t length)
+        {
+            if (length != 15)
+            {
+                return length;
+            }
+
+            std::byte extra;
+
+            do
+            {
+                if (ptr == end)
+                {
+                    throw std::runtime_error("corrupted compressed block");
+                }
+
+                extra = *ptr++;
+                length += static_cast<size_t>(extra);
+            } while (extra == std::byte(255));
+
+            return length;
+        }
+
+        // Returns the end of the common bytes of match and reference, up to limit
+        [[nodiscard]]
+        inline const std::byte *extendMatch(const std::byte *match, const std::byte *reference,
+                                            const std::byte *limit) noexcept
+        {
+            while (match + sizeof(uint64_t) <= limit)
+            {
+                uint64_t diff = loadUnaligned<uint64_t>(match) ^ loadUnaligned<uint64_t>(reference);
+
+                if (diff != 0)
+                {
+                    return match + std::countr_zero(diff) / CHAR_BIT;
+                }
+
+                match += sizeof(uint64_t);
+                reference += sizeof(uint64_t);
+            }
+
+            while (match < limit && *match == *reference)
+            {
+                ++match;
+                ++reference;
+            }
+
+            return match;
+        }
+
+        // Worst case, when nothing matches
+        [[nodiscard]]
+        constexpr size_t compressBound(size_t size) noexcept
+        {
+            return sizeof(uint64_t) + 1 + size + size / 255 + 1;
+        }
+
+        inline void writeSequence(std::byte *&ptr, const std::byte *literals, size_t literalsLength,
+                                  size_t offset, size_t matchLength) noexcept
+        {
+            auto *token = ptr++;
+            size_t matchCode = matchLength - MIN_MATCH;
+
+            *token = static_cast<std::byte>((std::min<size_t>(literalsLength, 15) << 4) |
+                                            std::min<size_t>(matchCode, 15));
+
+            if (literalsLength >= 15)
+            {
+                writeLength(ptr, literalsLength - 15);
+            }
+
+            std::memcpy(ptr, literals, literalsLength);
+            ptr += literalsLength;
+
+            uint16_t offset16 = static_cast<uint16_t>(offset);
+
+            std::memcpy(ptr, &offset16, sizeof(offset16));
+            ptr += sizeof(offset16);
+
+            if (matchCode >= 15)
+            {
+                writeLength(ptr, matchCode - 15);
+            }
+        }
+    }
+
+    [[nodiscard]]
+    SerDes::SerializedData compressBlock(std::span<const SerDes::SerializedData::Memory> input)
+    {
+        using namespace lz;
+
+        // Positions in the hash table are 32 bits
+        if (input.size() > UINT32_MAX)
+        {
+            throw std::length_error("block is too large");
+        }
+
+        auto output = std::make_unique_for_overwrite<SerDes::SerializedData::Memory[]>(
+            compressBound(input.size()));
+        uint64_t inputSize = input.size();
+        auto *ptr = output.get();
+        const auto *begin = input.data();
+        const auto *end = begin + input.size();
+        const auto *anchor = begin;
+
+        std::memcpy(ptr, &inputSize, sizeof(inputSize));
+        ptr += sizeof(inputSize);
+
+        if (input.size() > MIN_MATCH + LAST_LITERALS)
+        {
+            // Positions of the last sequences seen, from the beginning of input
+            std::array<uint32_t, 1 << HASH_BITS> table{};
+            const auto *matchLimit = end - LAST_LITERALS;
+            const auto *current = begin + 1;
+
+            while (current + MIN_MATCH <= matchLimit)
+            {
+                uint32_t sequence = loadUnaligned<uint32_t>(current);
+                uint32_t& entry = table[hash(sequence)];
+                const auto *candidate = begin + entry;
+
+                entry = static_cast<uint32_t>(current - begin);
+
+                if (static_cast<size_t>(current - candidate) > MAX_OFFSET ||
+                    loadUnaligned<uint32_t>(candidate) != sequence)
+                {
+                    // Skips faster through incompressible data
+                    current += 1 + ((current - anchor) >> 6);
+                    continue;
+                }
+
+                const auto *matchEnd = extendMatch(current + MIN_MATCH, candidate + MIN_MATCH, matchLimit);
+
+                writeSequence(ptr, anchor, current - anchor, current - candidate, matchEnd - current);
+                current = anchor = matchEnd;
+            }
+        }
+
+        // Last literals
+        size_t literalsLength = end - anchor;
+
+        *ptr++ = static_cast<std::byte>(std::min<size_t>(literalsLength, 15) << 4);
+
+        if (literalsLength >= 15)
+        {
+            writeLength(ptr, literalsLength - 15);
+        }
+
+        // Not memcpy(), anchor is null for an empty input
+        ptr = std::copy(anchor, end, ptr);
+
+        return {static_cast<size_t>(ptr - output.get()), std::move(output)};
+    }
+
+    [[nodiscard]]
+    SerDes::SerializedData decompressBlock(std::span<const SerDes::SerializedData::Memory> input)
+    {
+        using namespace lz;
+
+        if (input.size() < sizeof(uint64_t) + 1)
+        {
+            throw std::runtime_error("corrupted compressed block");
+        }
+
+        uint64_t outputSize = loadUnaligned<uint64_t>(input.data());
+
+        // A length byte stands for 255 bytes at most
+        if (outputSize / 255 > input.size())
+        {
+            throw std::runtime_error("corrupted compressed block");
+        }
+
+        auto output = std::make_unique_for_overwrite<SerDes::SerializedData::Memory[]>(
+            outputSize + COPY_SLACK);
+        auto *ptr = output.get();
+        auto *outputEnd = ptr + outputSize;
+        const auto *current = input.data() + sizeof(uint64_t);
+        const auto *end = input.data() + input.size();
+
+        while (true)
+        {
+            if (current == end)
+            {
+                throw std::runtime_error("corrupted compressed block");
+            }
+
+            auto token = static_cast<size_t>(*current++);
+            size_t literalsLength = readLength(current, end, token >> 4);
+
+            if (literalsLength > static_cast<size_t>(end - current) ||
+                literalsLength > static_cast<size_t>(outputEnd - ptr))
+            {
+                throw std::runtime_error("corrupted compressed block");
+            }
+
+            // Short literals are copied by 16 bytes, overwriting up to 15 bytes past them
+            if (literalsLength <= COPY_SLACK && end - current >= static_cast<ptrdiff_t>(COPY_SLACK))
+            {
+                std::memcpy(ptr, current, COPY_SLACK);
+            }
+            else
+            {
+                std::memcpy(ptr, current, literalsLength);
+            }
+
+            ptr += literalsLength;
+            current += literalsLength;
+
+            if (current == end)
+            {
+                break;
+            }
+
+            if (end - current < static_cast<ptrdiff_t>(sizeof(uint16_t)))
+            {
+                throw std::runtime_error("corrupted compressed block");
+            }
+
+            size_t offset = loadUnaligned<uint16_t>(current);
+
+            current += sizeof(uint16_t);
+
+            size_t matchLength = readLength(current, end, token & 15) + MIN_MATCH;
+
+            if (offset == 0 || offset > static_cast<size_t>(ptr - output.get()) ||
+                matchLength > static_cast<size_t>(outputEnd - ptr))
+            {
+                throw std::runtime_error("corrupted compressed block");
+            }
+
+            const auto *reference = ptr - offset;
+            auto *matchEnd = ptr + matchLength;
+
+            if (offset >= COPY_SLACK && matchLength <= COPY_SLACK)
+            {
+                std::memcpy(ptr, reference, COPY_SLACK);
+            }
+            else if (offset >= sizeof(uint64_t))
+            {
+                // May write up to 7 bytes past the match, into the slack at worst
+                for (; ptr < matchEnd; ptr += sizeof(uint64_t), reference += sizeof(uint64_t))
+                {
+                    std::memcpy(ptr, reference, sizeof(uint64_t));
+                }
+            }
+            else
+            {
+                // Overlapping match, repeating the last offset bytes
+                for (; ptr < matchEnd; ++ptr, ++reference)
+                {
+                    *ptr = *reference;
+                }
+            }
+
+            ptr = matchEnd;
+        }
+
+        if (ptr != outputEnd)
+        {
+            throw std::runtime_error("corrupted compressed block");
+        }
+
+        return {outputSize, std::move(output)};
+    }
+
+    /* Indexed layout, for big records mostly read one field or one map entry
+       at a time : a table of the uint32_t offsets of every field (plus the
+       end of the record) from the beginning of the record, then the fields
+       in the FixedWidth encoding, except maps. Their entries count is
+       followed by the array of the sorted keys, a table of the uint32_t
+       offsets of the values (plus their end) from the first one, then the
+       values. LazyRecord decodes fields or looks up map keys on demand */
+    template <typename T>
+    struct IndexedFieldCodec : FieldCodec<T, Encoding::FixedWidth>
+    { };
+
+    template <typename Key, typename Value>
+    struct IndexedFieldCodec<std::map<Key, Value>>
+    {
+        static_assert(std::is_arithmetic_v<Key>, "keys are binary searched in place");
+
+        using Map_t = std::map<Key, Value>;
+        using Size_t = typename Map_t::size_type;
+        using ValueCodec_t = FieldCodec<Value, Encoding::FixedWidth>;
+
+        static size_t size(const Map_t& map) noexcept
+        {
+            size_t totalSize = sizeof(Size_t) + map.size() * sizeof(Key) +
+                               (map.size() + 1) * sizeof(uint32_t);
+
+            for (const auto& [key, value] : map)
+            {
+                totalSize += ValueCodec_t::size(value);
+            }
+
+            return totalSize;
+        }
+
+        static void write(std::byte *&ptr, const Map_t& map) noexcept
+        {
+            Size_t count = map.size();
+
+            FieldCodec<Size_t>::write(ptr, count);
+
+            for (const auto& entry : map)
+            {
+                FieldCodec<Key>::write(ptr, entry.first);
+            }
+
+            auto *offsets = ptr;
+            auto *values = ptr + (count + 1) * sizeof(uint32_t);
+
+            ptr = values;
+
+            for (const auto& entry : map)
+            {
+                writeOffset(offsets, ptr - values);
+                ValueCodec_t::write(ptr, entry.second);
+            }
+
+            writeOffset(offsets, ptr - values);
+        }
+
+        static void read(const std::byte *&ptr, const std::byte *end, Map_t& map)
+        {
+            Size_t count = checkedCount(ptr, end);
+
+            map.clear();
+            ptr += sizeof(Size_t);
+
+            const auto *keys = ptr;
+
+            ptr += count * sizeof(Key) + (count + 1) * sizeof(uint32_t);
+
+            for (Size_t n = 0; n < count; ++n)
+            {
+                Key key;
+                Value value;
+
+                FieldCodec<Key>::read(keys, end, key);
+                ValueCodec_t::read(ptr, end, value);
+                map.emplace_hint(map.end(), key, std::move(value));
+            }
+        }
+
+        [[nodiscard]]
+        static Size_t count(const std::byte *field, const std::byte *end)
+        {
+            return checkedCount(field, end);
+        }
+
+        // Binary search of the keys array, only the value found is decoded
+        [[nodiscard]]
+        static std::optional<Value> lookup(const std::byte *field, const std::byte *end, const Key& key)
+        {
+            Size_t count = checkedCount(field, end);
+            const auto *keys = field + sizeof(Size_t);
+            Size_t first = 0;
+
+            for (Size_t length = count; length > 0; )
+            {
+                Size_t half = length / 2;
+
+                if (loadUnaligned<Key>(keys + (first + half) * sizeof(Key)) < key)
+                {
+                    first += half + 1;
+                    length -= half + 1;
+                }
+                else
+                {
+                    length = half;
+                }
+            }
+
+            if (first == count || loadUnaligned<Key>(keys + first * sizeof(Key)) != key)
+            {
+                return std::nullopt;
+            }
+
+            const auto *offsets = keys + count * sizeof(Key);
+            const auto *values = offsets + (count + 1) * sizeof(uint32_t);
+            uint32_t valueOffset = loadUnaligned<uint32_t>(offsets + first * sizeof(uint32_t));
+
+            if (valueOffset > static_cast<size_t>(end - values))
+            {
+                throw std::runtime_error("corrupted field offset");
+            }
+
+            const auto *value = values + valueOffset;
+            Value decoded;
+
+            ValueCodec_t::read(value, end, decoded);
+
+            return decoded;
+        }
+
+    private :
+        // Entries count, once checked that the keys and the offsets fit before end
+        [[nodiscard]]
+        static Size_t checkedCount(const std::byte *field, const std::byte *end)
+        {
+            auto available = static_cast<size_t>(end - field);
+
+            if (available < sizeof(Size_t) + sizeof(uint32_t))
+            {
+                throw std::runtime_error("truncated field");
+            }
+
+            Size_t count = loadUnaligned<Size_t>(field);
+
+            if (count > (available - sizeof(Size_t) - sizeof(uint32_t)) / (sizeof(Key) + sizeof(uint32_t)))
+            {
+                throw std::runtime_error("truncated field");
+            }
+
+            return count;
+        }
+
+        static void writeOffset(std::byte *&ptr, size_t offset) noexcept
+        {
+            assertm(offset <= UINT32_MAX, "Map values are too large for the indexed layout");
+            FieldCodec<uint32_t>::write(ptr, static_cast<uint32_t>(offset));
+        }
+    };
+
+    // Appends object to buffer in the indexed layout, returns its offset in it
+    template <HasSchema T>
+    size_t serializeIndexed(const T& object, SerDes::OutputBuffer& buffer)
+    {
+        constexpr size_t FIELDS_TOTAL = std::tuple_size_v<decltype(T::fields)>;
+        size_t offset = buffer.size();
+        size_t totalSize = (FIELDS_TOTAL + 1) * sizeof(uint32_t);
+
+        std::apply([&](auto... fieldPtrs)
+        {
+            ((totalSize += IndexedFieldCodec<ColumnType_t<T, decltype(fieldPtrs)>>::size(object.*fieldPtrs)), ...);
+        }, T::fields);
+        assertm(totalSize <= UINT32_MAX, "Record is too large for the indexed layout");
+
+        auto *begin = buffer.append(totalSize).data();
+        auto *offsets = begin;
+        auto *ptr = begin + (FIELDS_TOTAL + 1) * sizeof(uint32_t);
+
+        std::apply([&](auto... fieldPtrs)
+        {
+            ((FieldCodec<uint32_t>::write(offsets, static_cast<uint32_t>(ptr - begin)),
+              IndexedFieldCodec<ColumnType_t<T, decltype(fieldPtrs)>>::write(ptr, object.*fieldPtrs)), ...);
+        }, T::fields);
+
+        FieldCodec<uint32_t>::write(offsets, static_cast<uint32_t>(ptr - begin));
+
+        return offset;
+    }
+
+    // Record in the indexed layout, the fields being decoded only when asked for
+    template <HasSchema T>
+    class LazyRecord
+    {
+    public :
+        template <size_t Index>
+        using Field_t = ColumnType_t<T, std::tuple_element_t<Index, decltype(T::fields)>>;
+
+        // Field offsets are checked when the field is accessed
+        explicit LazyRecord(std::span<const SerDes::SerializedData::Memory> data)
+            : _data(data)
+        {
+            if (data.size() < (std::tuple_size_v<decltype(T::fields)> + 1) * sizeof(uint32_t))
+            {
+                throw std::runtime_error("truncated record");
+            }
+        }
+
+        template <size_t Index>
+        [[nodiscard]]
+        Field_t<Index> get() const
+        {
+            const auto *ptr = field<Index>();
+            Field_t<Index> value;
+
+            IndexedFieldCodec<Field_t<Index>>::read(ptr, dataEnd(), value);
+
+            return value;
+        }
+
+        // Entries count of a map field
+        template <size_t Index>
+        [[nodiscard]]
+        size_t count() const
+        {
+            return IndexedFieldCodec<Field_t<Index>>::count(field<Index>(), dataEnd());
+        }
+
+        // Value of key in a map field
+        template <size_t Index>
+        [[nodiscard]]
+        auto lookup(const typename Field_t<Index>::key_type& key) const
+        {
+            return IndexedFieldCodec<Field_t<Index>>::lookup(field<Index>(), dataEnd(), key);
+        }
+
+        // Decodes every field
+        void materialize(T& object) const
+        {
+            [&]<size_t... Indexes>(std::index_sequence<Indexes...>)
+            {
+                ((object.*std::get<Indexes>(T::fields) = get<Indexes>()), ...);
+            }(std::make_index_sequence<std::tuple_size_v<decltype(T::fields)>>());
+        }
+
+    private :
+        std::span<const SerDes::SerializedData::Memory> _data;
+
+        [[nodiscard]]
+        inline const std::byte *dataEnd() const noexcept { return _data.data() + _data.size(); }
+
+        template <size_t Index>
+        [[nodiscard]]
+        const std::byte *field() const
+        {
+            uint32_t offset = loadUnaligned<uint32_t>(_data.data() + Index * sizeof(uint32_t));
+
+            if (offset > _data.size())
+            {
+                throw std::runtime_error("corrupted field offset");
+            }
+
+            return _data.data() + offset;
+        }
+    };
+
+    // Runs func(threadIndex) on nbThreads threads, the calling one included
+    template <typename Func>
+    void runOnThreads(size_t nbThreads, Func&& func)
+    {
+        std::vector<std::jthread> threads;
+
+        for (size_t n = 1; n < nbThreads; ++n)
+        {
+            threads.emplace_back(func, n);
+        }
+
+        func(0);
+    }
+
+    // Boundaries of nbRanges ranges of the map holding the same entries count, give or take one
+    template <typename Map>
+    std::vector<typename Map::const_iterator> splitEntries(const Map& map, size_t nbRanges)
+    {
+        std::vector<typename Map::const_iterator> boundaries{map.begin()};
+        auto it = map.begin();
+        size_t index = 0;
+
+        for (size_t n = 1; n < nbRanges; ++n)
+        {
+            const size_t nextIndex = map.size() * n / nbRanges;
+
+            std::advance(it, nextIndex - index);
+            index = nextIndex;
+            boundaries.push_back(it);
+        }
+
+        boundaries.push_back(map.end());
+
+        return boundaries;
+    }
+
+    /* Serializes a Struct_3 with many entries on several threads, into the
+       same bytes than Struct_3::serializeInto() : the map is split into
+       ranges of as many entries, more of them than threads so that ranges of
+       uneven serialized sizes are balanced.
+       Threads first sum the size of each range, a prefix sum over the sizes
+       gives where each range goes in the output, then threads write the
+       ranges in place, each into its own region of the buffer */
+    size_t serializeParallel(const Struct_3& record, SerDes::OutputBuffer& buffer,
+                             size_t nbThreads = std::thread::hardware_concurrency())
+    {
+        using Map_t = decltype(record.m);
+        using Key_t = Map_t::key_type;
+        using Value_t = Map_t::mapped_type;
+
+        constexpr size_t RANGES_PER_THREAD = 4;
+        // Below, threads cost more than they save
+        constexpr size_t MIN_ENTRIES_PER_THREAD = 16'384;
+
+        nbThreads = std::clamp<size_t>(record.m.size() / MIN_ENTRIES_PER_THREAD, 1, std::max<size_t>(nbThreads, 1));
+
+        if (nbThreads == 1)
+        {
+            return record.serialize(buffer);
+        }
+
+        // Key ranges would leave most entries in one range when keys are clustered
+        const size_t rangesTotal = nbThreads * RANGES_PER_THREAD;
+        const auto boundaries = splitEntries(record.m, rangesTotal);
+
+        // Ranges are taken in order by whichever thread is free
+        std::vector<size_t> offsets(rangesTotal + 1);
+        std::atomic<size_t> nextRange = 0;
+        auto forEachRange = [&](auto&& rangeFunc)
+        {
+            runOnThreads(nbThreads, [&](size_t)
+            {
+                for (size_t range; (range = nextRange.fetch_add(1)) < rangesTotal; )
+                {
+                    rangeFunc(range);
+                }
+            });
+            nextRange = 0;
+        };
+
+        forEachRange([&](size_t range)
+        {
+            size_t rangeSize = 0;
+
+            for (auto it = boundaries[range]; it != boundaries[range + 1]; ++it)
+            {
+                rangeSize += FieldCodec<Key_t>::size(it->first) + FieldCodec<Value_t>::size(it->second);
+            }
+
+            offsets[range + 1] = rangeSize;
+        });
+
+        offsets[0] = FieldCodec<decltype(record.s)>::size(record.s) +
+                     FieldCodec<Map_t::size_type>::size(record.m.size());
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        size_t offset = buffer.size();
+        auto *begin = buffer.append(offsets.back()).data();
+        auto *ptr = begin;
+
+        FieldCodec<decltype(record.s)>::write(ptr, record.s);
+        FieldCodec<Map_t::size_type>::write(ptr, record.m.size());
+
+        forEachRange([&](size_t range)
+        {
+            auto *rangePtr = begin + offsets[range];
+
+            for (auto it = boundaries[range]; it != boundaries[range + 1]; ++it)
+            {
+                FieldCodec<Key_t>::write(rangePtr, it->first);
+                FieldCodec<Value_t>::write(rangePtr, it->second);
+            }
+
+            assertm(rangePtr == begin + offsets[range + 1], "Range size changed while serializing");
+        });
+
+        return offset;
+    }
+
+    // Owns a file descriptor, closed on destruction
+    class FileDescriptor
+    {
+    public :
+        FileDescriptor() = default;
+
+        FileDescriptor(const std::filesystem::path& path, int flags, mode_t mode = 0644)
+            : _fd(::open(path.c_str(), flags | O_CLOEXEC, mode))
+        {
+            if (_fd == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), "open " + path.string());
+            }
+        }
+
+        // Takes ownership of fd
+        explicit FileDescriptor(int fd) noexcept : _fd(fd) { }
+
+        FileDescriptor(FileDescriptor&& other) noexcept : _fd(std::exchange(other._fd, -1)) { }
+
+        FileDescriptor& operator=(FileDescriptor&& other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                _fd = std::exchange(other._fd, -1);
+            }
+
+            return *this;
+        }
+
+        ~FileDescriptor() { close(); }
+
+        [[nodiscard]]
+        inline int get() const noexcept { return _fd; }
+
+        void close() noexcept
+        {
+            if (_fd != -1)
+            {
+                ::close(_fd);
+                _fd = -1;
+            }
+        }
+
+    private :
+        int _fd = -1;
+    };
+
+    /* CRC32C (Castagnoli polynomial, the one of the SSE4.2 crc32 instruction).
+       The hardware version runs 3 independent crc32 chains over 3 adjacent
+       lanes of a block, hiding the 3 cycles latency of the instruction, then
+       folds them : the CRC of lane A followed by lane B is the CRC of A
+       shifted through len(B) zero bytes, xor the CRC of B. Shifting is linear
+       over GF(2), applied with tables computed at compile time */
+    namespace crc
+    {
+        // Reflected polynomial
+        constexpr uint32_t POLYNOMIAL = 0x82f63b78;
+        constexpr size_t LONG_LANE = 8192;
+        constexpr size_t SHORT_LANE = 256;
+
+        using Table_t = std::array<uint32_t, 256>;
+        // Applies a linear operator to a CRC one byte at a time
+        using ShiftTables_t = std::array<Table_t, 4>;
+        // Matrix of a linear operator over GF(2), one column per bit
+        using Operator_t = std::array<uint32_t, 32>;
+
+        [[nodiscard]]
+        constexpr Table_t makeByteTable() noexcept
+        {
+            Table_t table{};
+
+            for (uint32_t byte = 0; byte < 256; ++byte)
+            {
+                uint32_t crc = byte;
+
+                for (int bit = 0; bit < CHAR_BIT; ++bit)
+                {
+                    crc = crc & 1 ? (crc >> 1) ^ POLYNOMIAL : crc >> 1;
+                }
+
+                table[byte] = crc;
+            }
+
+            return table;
+        }
+
+        [[nodiscard]]
+        constexpr uint32_t multiply(const Operator_t& op, uint32_t vector) noexcept
+        {
+            uint32_t result = 0;
+
+            for (size_t bit = 0; vector != 0; ++bit, vector >>= 1)
+            {
+                if (vector & 1)
+                {
+                    result ^= op[bit];
+                }
+            }
+
+            return result;
+        }
+
+        [[nodiscard]]
+        constexpr Operator_t square(const Operator_t& op) noexcept
+        {
+            Operator_t squared{};
+
+            for (size_t bit = 0; bit < squared.size(); ++bit)
+            {
+                squared[bit] = multiply(op, op[bit]);
+            }
+
+            return squared;
+        }
+
+        // Tables shifting a CRC through zeroBytes zero bytes, a power of 2
+        [[nodiscard]]
+        constexpr ShiftTables_t makeShiftTables(size_t zeroBytes) noexcept
+        {
+            // One zero bit
+            Operator_t op{POLYNOMIAL};
+
+            for (size_t bit = 1; bit < op.size(); ++bit)
+            {
+                op[bit] = uint32_t(1) << (bit - 1);
+            }
+
+            for (size_t zeroBits = 1; zeroBits < zeroBytes * CHAR_BIT; zeroBits *= 2)
+            {
+                op = square(op);
+            }
+
+            ShiftTables_t tables{};
+
+            for (uint32_t byte = 0; byte < 256; ++byte)
+            {
+                for (size_t n = 0; n < tables.size(); ++n)
+                {
+                    tables[n][byte] = multiply(op, byte << (n * CHAR_BIT));
+                }
+            }
+
+            return tables;
+        }
+
+        constexpr Table_t BYTE_TABLE = makeByteTable();
+        constexpr ShiftTables_t LONG_SHIFT_TABLES = makeShiftTables(LONG_LANE);
+        constexpr ShiftTables_t SHORT_SHIFT_TABLES = makeShiftTables(SHORT_LANE);
+
+        [[nodiscard]]
+        inline uint32_t shift(const ShiftTables_t& tables, uint32_t crc) noexcept
+        {
+            return tables[0][crc & 0xff] ^ tables[1][(crc >> 8) & 0xff] ^
+                   tables[2][(crc >> 16) & 0xff] ^ tables[3][crc >> 24];
+        }
+
+        // Portable fallback, one table lookup per byte
+        [[nodiscard]]
+        inline uint32_t software(std::span<const std::byte> data, uint32_t crc = 0) noexcept
+        {
+            crc = ~crc;
+
+            for (std::byte byte : data)
+            {
+                crc = BYTE_TABLE[(crc ^ static_cast<uint32_t>(byte)) & 0xff] ^ (crc >> 8);
+            }
+
+            return ~crc;
+        }
+
+#if defined(__x86_64__)
+        [[nodiscard]]
+        inline bool hasHardwareSupport() noexcept
+        {
+            static const bool hasSse42 = __builtin_cpu_supports("sse4.2");
+
+            return hasSse42;
+        }
+
+        // Lanes of laneSize bytes while there is room for 3 of them
+        template <size_t laneSize>
+        [[gnu::target("sse4.2")]]
+        inline void hardwareLanes(const std::byte *&ptr, const std::byte *end, uint64_t& crc,
+                                  const ShiftTables_t& shiftTables) noexcept
+        {
+            while (end - ptr >= static_cast<ptrdiff_t>(3 * laneSize))
+            {
+                uint64_t crc1 = 0;
+                uint64_t crc2 = 0;
+
+                for (const auto *laneEnd = ptr + laneSize; ptr < laneEnd; ptr += sizeof(uint64_t))
+                {
+                    crc = _mm_crc32_u64(crc, loadUnaligned<uint64_t>(ptr));
+                    crc1 = _mm_crc32_u64(crc1, loadUnaligned<uint64_t>(ptr + laneSize));
+                    crc2 = _mm_crc32_u64(crc2, loadUnaligned<uint64_t>(ptr + 2 * laneSize));
+                }
+
+                crc = shift(shiftTables, static_cast<uint32_t>(crc)) ^ crc1;
+                crc = shift(shiftTables, static_cast<uint32_t>(crc)) ^ crc2;
+                ptr += 2 * laneSize;
+            }
+        }
+
+        [[nodiscard]]
+        [[gnu::target("sse4.2")]]
+        inline uint32_t hardware(std::span<const std::byte> data, uint32_t crc = 0) noexcept
+        {
+            const auto *ptr = data.data();
+            const auto *end = ptr + data.size();
+            uint64_t crc64 = ~crc;
+
+            hardwareLanes<LONG_LANE>(ptr, end, crc64, LONG_SHIFT_TABLES);
+            hardwareLanes<SHORT_LANE>(ptr, end, crc64, SHORT_SHIFT_TABLES);
+
+            for (; end - ptr >= static_cast<ptrdiff_t>(sizeof(uint64_t)); ptr += sizeof(uint64_t))
+            {
+                crc64 = _mm_crc32_u64(crc64, loadUnaligned<uint64_t>(ptr));
+            }
+
+            auto crc32 = static_cast<uint32_t>(crc64);
+
+            for (; ptr < end; ++ptr)
+            {
+                crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(*ptr));
+            }
+
+            return ~crc32;
+        }
+#endif
+    }
+
+    // Pass the CRC of the previous bytes as crc to checksum data in several parts
+    [[nodiscard]]
+    inline uint32_t crc32c(std::span<const std::byte> data, uint32_t crc = 0) noexcept
+    {
+#if defined(__x86_64__)
+        if (crc::hasHardwareSupport())
+        {
+            return crc::hardware(data, crc);
+        }
+#endif
+
+        return crc::software(data, crc);
+    }
+
+    // Records are streamed as frames : header then payload
+    struct FrameHeader
+    {
+        uint64_t size;
+        // CRC32C of size then of the payload
+        uint32_t checksum;
+        // Written as 0 instead of uninitialized padding
+        uint32_t reserved = 0;
+    };
+
+    [[nodiscard]]
+    inline uint32_t frameChecksum(std::span<const std::byte> payload) noexcept
+    {
+        uint64_t size = payload.size();
+
+        return crc32c(payload, crc32c(std::as_bytes(std::span(&size, 1))));
+    }
+
+    /* Appends records to a file as frames, gathered in batches written by a
+       background thread with writev(), one syscall for many frames. While a
+       batch is being written, the next one is filled (double buffering) and
+       the producer only waits when both are full */
+    class RecordWriter
+    {
+    public :
+        explicit RecordWriter(const std::filesystem::path& path, size_t batchBytes = 1 << 20)
+            : _file(path, O_WRONLY | O_CREAT | O_TRUNC),
+              _batchBytes(batchBytes),
+              _flushThread([this]() { flushLoop(); })
+        { }
+
+        RecordWriter(const RecordWriter&) = delete;
+        RecordWriter& operator=(const RecordWriter&) = delete;
+
+        ~RecordWriter()
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+                // Call close() to get write errors
+            }
+        }
+
+        void write(SerDes::SerializedData data)
+        {
+            _filling.bytes += sizeof(FrameHeader) + data.size;
+            _filling.headers.push_back({data.size, 0});
+            _filling.records.push_back(std::move(data));
+
+            if (_filling.bytes >= _batchBytes)
+            {
+                submitFillingBatch();
+            }
+        }
+
+        inline void write(const SerDes& record) { write(record.serialize()); }
+
+        // Returns once every record written so far is in the file
+        void flush()
+        {
+            submitFillingBatch();
+
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            _condVar.wait(lock, [this]() { return !_hasFlushingBatch; });
+            rethrowFlushError();
+        }
+
+        void close()
+        {
+            if (!_flushThread.joinable())
+            {
+                return;
+            }
+
+            // The thread is joined and the file closed even if a write failed
+            std::exception_ptr error;
+
+            try
+            {
+                flush();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                _closing = true;
+            }
+
+            _condVar.notify_all();
+            _flushThread.join();
+            _file.close();
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private :
+        struct Batch
+        {
+            std::vector<SerDes::SerializedData> records;
+            // Kept beside the records so iovecs can point to them
+            std::vector<FrameHeader> headers;
+            size_t bytes = 0;
+
+            void clear() noexcept
+            {
+                records.clear();
+                headers.clear();
+                bytes = 0;
+            }
+        };
+
+        FileDescriptor _file;
+        const size_t _batchBytes;
+        Batch _filling;
+        Batch _flushing;
+        bool _hasFlushingBatch = false;
+        bool _closing = false;
+        std::exception_ptr _flushError;
+        std::mutex _mutex;
+        std::condition_variable _condVar;
+        std::thread _flushThread;
+
+        void rethrowFlushError()
+        {
+            if (_flushError)
+            {
+                std::rethrow_exception(std::exchange(_flushError, nullptr));
+            }
+        }
+
+        void submitFillingBatch()
+        {
+            if (_filling.records.empty())
+            {
+                return;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+
+                _condVar.wait(lock, [this]() { return !_hasFlushingBatch; });
+                rethrowFlushError();
+                std::swap(_filling, _flushing);
+                _hasFlushingBatch = true;
+            }
+
+            _condVar.notify_all();
+            _filling.clear();
+        }
+
+        void flushLoop()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            while (true)
+            {
+                _condVar.wait(lock, [this]() { return _hasFlushingBatch || _closing; });
+
+                if (!_hasFlushingBatch)
+                {
+                    return;
+                }
+
+                lock.unlock();
+
+                try
+                {
+                    writeBatch(_flushing);
+                }
+                catch (...)
+                {
+                    _flushError = std::current_exception();
+                }
+
+                lock.lock();
+                _hasFlushingBatch = false;
+                _condVar.notify_all();
+            }
+        }
+
+        // Checksums are computed here, off the producer thread
+        void writeBatch(Batch& batch)
+        {
+            std::vector<iovec> iovecs;
+
+            iovecs.reserve(batch.records.size() * 2);
+
+            for (size_t n = 0; n < batch.records.size(); ++n)
+            {
+                batch.headers[n].checksum = frameChecksum({batch.records[n].data.get(), batch.records[n].size});
+                iovecs.push_back({&batch.headers[n], sizeof(FrameHeader)});
+                iovecs.push_back({batch.records[n].data.get(), batch.records[n].size});
+            }
+
+            writeAll(iovecs);
+        }
+
+        // writev() takes at most IOV_MAX iovecs and may write partially
+        void writeAll(std::vector<iovec>& iovecs)
+        {
+            size_t first = 0;
+
+            while (first < iovecs.size())
+            {
+                int count = static_cast<int>(std::min<size_t>(iovecs.size() - first, IOV_MAX));
+                ssize_t written = ::writev(_file.get(), &iovecs[first], count);
+
+                if (written == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw std::system_error(errno, std::generic_category(), "writev");
+                }
+
+                for (auto left = static_cast<size_t>(written); left > 0; )
+                {
+                    auto& iov = iovecs[first];
+                    size_t consumed = std::min(left, iov.iov_len);
+
+                    iov.iov_base = static_cast<std::byte *>(iov.iov_base) + consumed;
+                    iov.iov_len -= consumed;
+                    left -= consumed;
+
+                    if (iov.iov_len == 0)
+                    {
+                        ++first;
+                    }
+                }
+
+                // Skips empty payloads
+                while (first < iovecs.size() && iovecs[first].iov_len == 0)
+                {
+                    ++first;
+                }
+            }
+        }
+    };
+
+    // Streams back the frames of a file written by RecordWriter, one chunk at a time
+    class RecordReader
+    {
+    public :
+        explicit RecordReader(const std::filesystem::path& path, size_t chunkSize = 1 << 16)
+            : _file(path, O_RDONLY),
+              _fileSize(std::filesystem::file_size(path)),
+              _chunk(std::make_unique_for_overwrite<std::byte[]>(chunkSize)),
+              _chunkSize(chunkSize)
+        { }
+
+        // Returns std::nullopt at the end of the file
+        [[nodiscard]]
+        std::optional<SerDes::SerializedData> next()
+        {
+            FrameHeader header;
+
+            if (!read(reinterpret_cast<std::byte *>(&header), sizeof(header)))
+            {
+                return std::nullopt;
+            }
+
+            // Checked before allocating a size that may be corrupted
+            if (header.reserved != 0 || header.size > _fileSize - _position)
+            {
+                throw std::runtime_error("corrupted frame header");
+            }
+
+            SerDes::SerializedData data
+            {
+                header.size,
+                std::make_unique_for_overwrite<SerDes::SerializedData::Memory[]>(header.size)
+            };
+
+            if (!read(data.data.get(), header.size))
+            {
+                throw std::runtime_error("truncated frame");
+            }
+
+            if (frameChecksum({data.data.get(), data.size}) != header.checksum)
+            {
+                throw std::runtime_error("corrupted frame");
+            }
+
+            return data;
+        }
+
+    private :
+        FileDescriptor _file;
+        uint64_t _fileSize;
+        // Bytes of the file returned by read() so far
+        uint64_t _position = 0;
+        std::unique_ptr<std::byte[]> _chunk;
+        size_t _chunkSize;
+        size_t _chunkBegin = 0;
+        size_t _chunkEnd = 0;
+
+        // Returns false if the file ends before the first byte,
+        // throws if it ends in the middle
+        bool read(std::byte *out, size_t size)
+        {
+            size_t copied = 0;
+
+            while (copied < size)
+            {
+                if (_chunkBegin == _chunkEnd)
+                {
+                    // Big payloads are read directly, not through the chunk
+                    bool direct = size - copied >= _chunkSize;
+                    ssize_t bytesRead = ::read(_file.get(),
+                                               direct ? out + copied : _chunk.get(),
+                                               direct ? size - copied : _chunkSize);
+
+                    if (bytesRead == -1)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw std::system_error(errno, std::generic_category(), "read");
+                    }
+
+                    if (bytesRead == 0)
+                    {
+                        if (copied == 0)
+                        {
+                            return false;
+                        }
+
+                        throw std::runtime_error("truncated frame");
+                    }
+
+                    if (direct)
+                    {
+                        copied += bytesRead;
+                        continue;
+                    }
+
+                    _chunkBegin = 0;
+                    _chunkEnd = bytesRead;
+                }
+
+                size_t available = std::min(size - copied, _chunkEnd - _chunkBegin);
+
+                std::memcpy(out + copied, _chunk.get() + _chunkBegin, available);
+                _chunkBegin += available;
+                copied += available;
+            }
+
+            _position += size;
+
+            return true;
+        }
+    };
+
+    // Writes all of data at offset, pwrite() may write partially
+    void pwriteAll(int fd, std::span<const std::byte> data, uint64_t offset)
+    {
+        while (!data.empty())
+        {
+            ssize_t written = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+
+            if (written == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                throw std::system_error(errno, std::generic_category(), "pwrite");
+            }
+
+            if (written == 0)
+            {
+                throw std::runtime_error("pwrite wrote nothing");
+            }
+
+            data = data.subspan(written);
+            offset += written;
+        }
+    }
+
+    /* Asynchronous positioned writes of the buffers of a fixed set, each
+       identified by its index : submit() returns as soon as the write is
+       queued, waitCompletion() returns the index of a buffer written, with
+       the error if its write failed so the buffer can be reused anyway */
+    struct WriteCompletion
+    {
+        uint32_t bufferIndex;
+        std::exception_ptr error;
+    };
+
+    class WriteQueue
+    {
+    public :
+        virtual ~WriteQueue() = default;
+
+        virtual void submit(uint32_t bufferIndex, std::span<const std::byte> data, uint64_t offset) = 0;
+        // Only throws if the queue itself failed
+        virtual WriteCompletion waitCompletion() = 0;
+    };
+
+    /* Linux io_uring through raw syscalls, without liburing : writes are
+       queued in the submission ring shared with the kernel and their results
+       read from the completion ring. Buffers are registered once so the
+       kernel doesn't map them again for every write (IORING_OP_WRITE_FIXED) */
+    class UringWriteQueue : public WriteQueue
+    {
+    public :
+        // Throws std::system_error if io_uring isn't available
+        UringWriteQueue(int fd, std::span<const iovec> buffers) : _fd(fd), _requests(buffers.size())
+        {
+            io_uring_params params{};
+            int ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, buffers.size(), &params));
+
+            if (ringFd == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+            }
+
+            _ring = FileDescriptor(ringFd);
+            _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+            {
+                _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+            }
+
+            _sqRing = map(_sqRingSize, IORING_OFF_SQ_RING);
+            _cqRing = params.features & IORING_FEAT_SINGLE_MMAP
+                ? _sqRing : map(_cqRingSize, IORING_OFF_CQ_RING);
+            _sqes = static_cast<io_uring_sqe *>(map(_sqesSize, IORING_OFF_SQES));
+
+            auto *sqRing = static_cast<std::byte *>(_sqRing);
+            auto *cqRing = static_cast<std::byte *>(_cqRing);
+
+            _sqTail = reinterpret_cast<uint32_t *>(sqRing + params.sq_off.tail);
+            _sqMask = *reinterpret_cast<uint32_t *>(sqRing + params.sq_off.ring_mask);
+            _sqArray = reinterpret_cast<uint32_t *>(sqRing + params.sq_off.array);
+            _cqHead = reinterpret_cast<uint32_t *>(cqRing + params.cq_off.head);
+            _cqTail = reinterpret_cast<uint32_t *>(cqRing + params.cq_off.tail);
+            _cqMask = *reinterpret_cast<uint32_t *>(cqRing + params.cq_off.ring_mask);
+            _cqes = reinterpret_cast<io_uring_cqe *>(cqRing + params.cq_off.cqes);
+
+            if (::syscall(__NR_io_uring_register, _ring.get(), IORING_REGISTER_BUFFERS,
+                          buffers.data(), buffers.size()) == -1)
+            {
+                int error = errno;
+
+                unmap();
+                throw std::system_error(error, std::generic_category(), "io_uring_register");
+            }
+        }
+
+        UringWriteQueue(const UringWriteQueue&) = delete;
+        UringWriteQueue& operator=(const UringWriteQueue&) = delete;
+
+        ~UringWriteQueue() override
+        {
+            _ring.close();
+            unmap();
+        }
+
+        void submit(uint32_t bufferIndex, std::span<const std::byte> data, uint64_t offset) override
+        {
+            _requests[bufferIndex] = {data, offset};
+            queueWrite(bufferIndex);
+        }
+
+        WriteCompletion waitCompletion() override
+        {
+            while (true)
+            {
+                uint32_t head = *_cqHead;
+
+                if (head == std::atomic_ref<uint32_t>(*_cqTail).load(std::memory_order_acquire))
+                {
+                    enter(0, 1, IORING_ENTER_GETEVENTS);
+                    continue;
+                }
+
+                io_uring_cqe cqe = _cqes[head & _cqMask];
+
+                std::atomic_ref<uint32_t>(*_cqHead).store(head + 1, std::memory_order_release);
+
+                auto bufferIndex = static_cast<uint32_t>(cqe.user_data);
+                auto& request = _requests[bufferIndex];
+
+                if (cqe.res < 0)
+                {
+                    return {bufferIndex, std::make_exception_ptr(
+                        std::system_error(-cqe.res, std::generic_category(), "io_uring write"))};
+                }
+
+                // Not submitted again, it would never end
+                if (cqe.res == 0)
+                {
+                    return {bufferIndex, std::make_exception_ptr(
+                        std::runtime_error("io_uring write wrote nothing"))};
+                }
+
+                // Writes the rest of a partial write
+                request.data = request.data.subspan(cqe.res);
+                request.offset += cqe.res;
+
+                if (request.data.empty())
+                {
+                    return {bufferIndex, nullptr};
+                }
+
+                queueWrite(bufferIndex);
+            }
+        }
+
+    private :
+        struct Request
+        {
+            std::span<const std::byte> data;
+            uint64_t offset;
+        };
+
+        int _fd;
+        FileDescriptor _ring;
+        std::vector<Request> _requests;
+        size_t _sqRingSize;
+        size_t _cqRingSize;
+        size_t _sqesSize;
+        void *_sqRing = MAP_FAILED;
+        void *_cqRing = MAP_FAILED;
+        io_uring_sqe *_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        uint32_t *_sqTail;
+        uint32_t _sqMask;
+        uint32_t *_sqArray;
+        uint32_t *_cqHead;
+        uint32_t *_cqTail;
+        uint32_t _cqMask;
+        io_uring_cqe *_cqes;
+
+        void *map(size_t size, off_t offset)
+        {
+            void *mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                   _ring.get(), offset);
+
+            if (mapping == MAP_FAILED)
+            {
+                int error = errno;
+
+                unmap();
+                throw std::system_error(error, std::generic_category(), "mmap");
+            }
+
+            return mapping;
+        }
+
+        void unmap() noexcept
+        {
+            if (_sqes != MAP_FAILED)
+            {
+                ::munmap(_sqes, _sqesSize);
+            }
+
+            if (_cqRing != MAP_FAILED && _cqRing != _sqRing)
+            {
+                ::munmap(_cqRing, _cqRingSize);
+            }
+
+            if (_sqRing != MAP_FAILED)
+            {
+                ::munmap(_sqRing, _sqRingSize);
+            }
+
+            _sqRing = _cqRing = _sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        }
+
+        // There is one ring entry per buffer, so the ring is never full
+        void queueWrite(uint32_t bufferIndex)
+        {
+            const auto& request = _requests[bufferIndex];
+            uint32_t tail = *_sqTail;
+            uint32_t index = tail & _sqMask;
+            io_uring_sqe& sqe = _sqes[index];
+
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_WRITE_FIXED;
+            sqe.fd = _fd;
+            sqe.addr = reinterpret_cast<uint64_t>(request.data.data());
+            sqe.len = static_cast<uint32_t>(request.data.size());
+            sqe.off = request.offset;
+            sqe.buf_index = static_cast<uint16_t>(bufferIndex);
+            sqe.user_data = bufferIndex;
+            _sqArray[index] = index;
+            std::atomic_ref<uint32_t>(*_sqTail).store(tail + 1, std::memory_order_release);
+            enter(1, 0, 0);
+        }
+
+        void enter(uint32_t toSubmit, uint32_t minComplete, uint32_t flags)
+        {
+            while (::syscall(__NR_io_uring_enter, _ring.get(), toSubmit, minComplete, flags, nullptr, 0) == -1)
+            {
+                if (errno != EINTR)
+                {
+                    throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+                }
+            }
+        }
+    };
+
+    // Fallback when io_uring isn't available : pwrite() calls on a few threads
+    class ThreadPoolWriteQueue : public WriteQueue
+    {
+    public :
+        ThreadPoolWriteQueue(int fd, size_t nbThreads) : _fd(fd)
+        {
+            for (size_t n = 0; n < nbThreads; ++n)
+            {
+                _threads.emplace_back([this]() { writeLoop(); });
+            }
+        }
+
+        ThreadPoolWriteQueue(const ThreadPoolWriteQueue&) = delete;
+        ThreadPoolWriteQueue& operator=(const ThreadPoolWriteQueue&) = delete;
+
+        // Waits for the writes in flight
+        ~ThreadPoolWriteQueue() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                _stopping = true;
+            }
+
+            _condVar.notify_all();
+
+            for (auto& thread : _threads)
+            {
+                thread.join();
+            }
+        }
+
+        void submit(uint32_t bufferIndex, std::span<const std::byte> data, uint64_t offset) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                _requests.push_back({bufferIndex, data, offset});
+            }
+
+            _condVar.notify_all();
+        }
+
+        WriteCompletion waitCompletion() override
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            _condVar.wait(lock, [this]() { return !_completions.empty(); });
+
+            WriteCompletion completion = _completions.front();
+
+            _completions.pop_front();
+
+            return completion;
+        }
+
+    private :
+        struct Request
+        {
+            uint32_t bufferIndex;
+            std::span<const std::byte> data;
+            uint64_t offset;
+        };
+
+        int _fd;
+        std::deque<Request> _requests;
+        std::deque<WriteCompletion> _completions;
+        bool _stopping = false;
+        std::mutex _mutex;
+        std::condition_variable _condVar;
+        std::vector<std::thread> _threads;
+
+        void writeLoop()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            while (true)
+            {
+                _condVar.wait(lock, [this]() { return !_requests.empty() || _stopping; });
+
+                if (_requests.empty())
+                {
+                    return;
+                }
+
+                Request request = _requests.front();
+                std::exception_ptr error;
+
+                _requests.pop_front();
+                lock.unlock();
+
+                try
+                {
+                    pwriteAll(_fd, request.data, request.offset);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                lock.lock();
+                _completions.push_back({request.bufferIndex, error});
+                _condVar.notify_all();
+            }
+        }
+    };
+
+    /* Appends records to a file as frames, like RecordWriter, but serialized
+       straight into a few preallocated buffers and written asynchronously :
+       when a buffer is full it is submitted and the producer goes on with a
+       free one, only waiting when all of them are being written. Writes go
+       through io_uring, or through pwrite() on a thread pool when io_uring
+       isn't available. Records bigger than a buffer are written synchronously.
+       After a failed write the file has a hole : every call but close()
+       throws the first error again */
+    class AsyncRecordWriter
+    {
+    public :
+        enum class Backend
+        {
+            IoUring,
+            ThreadPool
+        };
+
+        explicit AsyncRecordWriter(const std::filesystem::path& path, size_t bufferSize = 1 << 20,
+                                   size_t nbBuffers = 4, Backend backend = Backend::IoUring)
+            : _file(path, O_WRONLY | O_CREAT | O_TRUNC),
+              _bufferSize(bufferSize),
+              _memory(std::make_unique<std::byte[]>(bufferSize * nbBuffers))
+        {
+            if (nbBuffers == 0)
+            {
+                throw std::invalid_argument("at least one buffer is needed");
+            }
+
+            std::vector<iovec> buffers;
+
+            for (uint32_t n = 0; n < nbBuffers; ++n)
+            {
+                buffers.push_back({_memory.get() + n * bufferSize, bufferSize});
+                _freeBuffers.push_back(n);
+            }
+
+            if (backend == Backend::IoUring)
+            {
+                try
+                {
+                    _queue = std::make_unique<UringWriteQueue>(_file.get(), buffers);
+                }
+                catch (const std::system_error&)
+                {
+                    backend = Backend::ThreadPool;
+                }
+            }
+
+            if (backend == Backend::ThreadPool)
+            {
+                _queue = std::make_unique<ThreadPoolWriteQueue>(_file.get(), std::min<size_t>(nbBuffers, 4));
+            }
+
+            _backend = backend;
+            takeFreeBuffer();
+        }
+
+        AsyncRecordWriter(const AsyncRecordWriter&) = delete;
+        AsyncRecordWriter& operator=(const AsyncRecordWriter&) = delete;
+
+        ~AsyncRecordWriter()
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+                // Call close() to get write errors
+            }
+        }
+
+        // Backend used, IoUring falls back to ThreadPool when not available
+        [[nodiscard]]
+        inline Backend backend() const noexcept { return _backend; }
+
+        void write(const SerDes& record)
+        {
+            rethrowWriteError();
+
+            size_t size = record.serializedSize();
+            size_t frameSize = sizeof(FrameHeader) + size;
+
+            if (frameSize > _bufferSize)
+            {
+                writeSynchronously(record.serialize());
+                return;
+            }
+
+            if (_used + frameSize > _bufferSize)
+            {
+                submitCurrentBuffer();
+            }
+
+            auto *frame = currentBuffer() + _used;
+            auto payload = std::span(frame + sizeof(FrameHeader), size);
+
+            record.serializeInto(payload);
+
+            FrameHeader header{size, frameChecksum(payload)};
+
+            std::memcpy(frame, &header, sizeof(header));
+            _used += frameSize;
+        }
+
+        void write(const SerDes::SerializedData& data)
+        {
+            rethrowWriteError();
+
+            size_t frameSize = sizeof(FrameHeader) + data.size;
+            std::span payload(data.data.get(), data.size);
+
+            if (frameSize > _bufferSize)
+            {
+                writeSynchronously(data);
+                return;
+            }
+
+            if (_used + frameSize > _bufferSize)
+            {
+                submitCurrentBuffer();
+            }
+
+            FrameHeader header{data.size, frameChecksum(payload)};
+
+            std::memcpy(currentBuffer() + _used, &header, sizeof(header));
+            std::ranges::copy(payload, currentBuffer() + _used + sizeof(header));
+            _used += frameSize;
+        }
+
+        // Returns once every record written so far is in the file
+        void flush()
+        {
+            rethrowWriteError();
+            submitCurrentBuffer();
+
+            while (_inFlight > 0)
+            {
+                waitCompletion();
+            }
+        }
+
+        // Throws the first write error, if any
+        void close()
+        {
+            if (!_queue)
+            {
+                return;
+            }
+
+            try
+            {
+                flush();
+            }
+            catch (...)
+            {
+                // Kept in _writeError, unless the queue itself failed
+                if (!_writeError)
+                {
+                    _writeError = std::current_exception();
+                }
+            }
+
+            try
+            {
+                // Writes submitted before an error may still be in flight
+                for (; _inFlight > 0; --_inFlight)
+                {
+                    [[maybe_unused]] auto _ = _queue->waitCompletion();
+                }
+            }
+            catch (...)
+            {
+                // Destroying the queue drops the remaining writes
+            }
+
+            _queue.reset();
+            _file.close();
+            rethrowWriteError();
+        }
+
+    private :
+        FileDescriptor _file;
+        const size_t _bufferSize;
+        std::unique_ptr<std::byte[]> _memory;
+        std::unique_ptr<WriteQueue> _queue;
+        Backend _backend;
+        std::vector<uint32_t> _freeBuffers;
+        uint32_t _current;
+        size_t _used = 0;
+        size_t _inFlight = 0;
+        uint64_t _fileSize = 0;
+        std::exception_ptr _writeError;
+
+        [[nodiscard]]
+        inline std::byte *currentBuffer() const noexcept { return _memory.get() + _current * _bufferSize; }
+
+        void rethrowWriteError()
+        {
+            if (_writeError)
+            {
+                std::rethrow_exception(_writeError);
+            }
+        }
+
+        // The buffer is free again even if its write failed
+        void waitCompletion()
+        {
+            auto [bufferIndex, error] = _queue->waitCompletion();
+
+            _freeBuffers.push_back(bufferIndex);
+            --_inFlight;
+
+            if (error)
+            {
+                if (!_writeError)
+                {
+                    _writeError = error;
+                }
+
+                std::rethrow_exception(error);
+            }
+        }
+
+        void takeFreeBuffer()
+        {
+            if (_freeBuffers.empty())
+            {
+                waitCompletion();
+            }
+
+            _current = _freeBuffers.back();
+            _freeBuffers.pop_back();
+            _used = 0;
+        }
+
+        void submitCurrentBuffer()
+        {
+            if (_used == 0)
+            {
+                return;
+            }
+
+            _queue->submit(_current, {currentBuffer(), _used}, _fileSize);
+            _fileSize += _used;
+            ++_inFlight;
+            // Submitted, never again even if no free buffer comes back
+            _used = 0;
+            takeFreeBuffer();
+        }
+
+        void writeSynchronously(const SerDes::SerializedData& data)
+        {
+            std::span payload(data.data.get(), data.size);
+            FrameHeader header{data.size, frameChecksum(payload)};
+
+            submitCurrentBuffer();
+
+            try
+            {
+                pwriteAll(_file.get(), std::as_bytes(std::span(&header, 1)), _fileSize);
+                pwriteAll(_file.get(), payload, _fileSize + sizeof(header));
+            }
+            catch (...)
+            {
+                _writeError = std::current_exception();
+                throw;
+            }
+
+            _fileSize += sizeof(header) + data.size;
+        }
+    };
+
+    // Whole file mapped read-only in memory, pages are loaded on first access
+    class MappedFile
+    {
+    public :
+        explicit MappedFile(const std::filesystem::path& path)
+        {
+            FileDescriptor file(path, O_RDONLY);
+            struct stat status;
+
+            if (::fstat(file.get(), &status) == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), "fstat");
+            }
+
+            _size = static_cast<size_t>(status.st_size);
+
+            if (_size == 0)
+            {
+                return;
+            }
+
+            void *mapping = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, file.get(), 0);
+
+            if (mapping == MAP_FAILED)
+            {
+                throw std::system_error(errno, std::generic_category(), "mmap");
+            }
+
+            _data = static_cast<const std::byte *>(mapping);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile()
+        {
+            if (_data)
+            {
+                ::munmap(const_cast<std::byte *>(_data), _size);
+            }
+        }
+
+        [[nodiscard]]
+        inline std::span<const std::byte> bytes() const noexcept { return {_data, _size}; }
+
+    private :
+        const std::byte *_data = nullptr;
+        size_t _size = 0;
+    };
+
+    /* Archive of serialized records with random access : records are stored
+       back to back, followed by an index holding the offset of every record
+       (plus the end of the last one) and a fixed-size footer locating it.
+       All integers are uint64_t, the index starts on an 8 bytes boundary */
+    struct ArchiveFooter
+    {
+        static constexpr uint64_t MAGIC = 0x5345524445534152; // "RASEDRES"
+
+        uint64_t recordsCount;
+        uint64_t indexOffset;
+        uint64_t magic;
+    };
+
+    class ArchiveWriter
+    {
+    public :
+        explicit ArchiveWriter(const std::filesystem::path& path)
+            : _file(path, O_WRONLY | O_CREAT | O_TRUNC)
+        { }
+
+        ArchiveWriter(const ArchiveWriter&) = delete;
+        ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+        ~ArchiveWriter()
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+                // Call close() to get write errors
+            }
+        }
+
+        // Returns the index of the record in the archive
+        size_t append(const SerDes& record)
+        {
+            _offsets.push_back(_fileSize + _buffer.size());
+            record.serialize(_buffer);
+
+            if (_buffer.size() >= FLUSH_THRESHOLD)
+            {
+                flushBuffer();
+            }
+
+            return _offsets.size() - 1;
+        }
+
+        // Writes the index and the footer, the archive can't be appended anymore
+        void close()
+        {
+            // Not written twice if a write fails
+            if (std::exchange(_closed, true))
+            {
+                return;
+            }
+
+            uint64_t indexOffset = _fileSize + _buffer.size();
+            size_t padding = (sizeof(uint64_t) - indexOffset % sizeof(uint64_t)) % sizeof(uint64_t);
+
+            std::ranges::fill(_buffer.append(padding), std::byte(0));
+            indexOffset += padding;
+            _offsets.push_back(indexOffset - padding);
+
+            for (uint64_t offset : _offsets)
+            {
+                std::memcpy(_buffer.append(sizeof(offset)).data(), &offset, sizeof(offset));
+            }
+
+            ArchiveFooter footer{_offsets.size() - 1, indexOffset, ArchiveFooter::MAGIC};
+
+            std::memcpy(_buffer.append(sizeof(footer)).data(), &footer, sizeof(footer));
+            flushBuffer();
+            _file.close();
+        }
+
+    private :
+        static constexpr size_t FLUSH_THRESHOLD = 1 << 20;
+
+        FileDescriptor _file;
+        SerDes::OutputBuffer _buffer;
+        std::vector<uint64_t> _offsets;
+        uint64_t _fileSize = 0;
+        bool _closed = false;
+
+        void flushBuffer()
+        {
+            auto bytes = _buffer.bytes();
+
+            while (!bytes.empty())
+            {
+                ssize_t written = ::write(_file.get(), bytes.data(), bytes.size());
+
+                if (written == -1)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw std::system_error(errno, std::generic_category(), "write");
+                }
+
+                bytes = bytes.subspan(written);
+            }
+
+            _fileSize += _buffer.size();
+            _buffer.clear();
+        }
+    };
+
+    // Opening only reads the footer, whatever the archive size
+    class ArchiveReader
+    {
+    public :
+        explicit ArchiveReader(const std::filesystem::path& path) : _file(path)
+        {
+            auto bytes = _file.bytes();
+            ArchiveFooter footer;
+
+            if (bytes.size() < sizeof(footer))
+            {
+                throw std::runtime_error("archive is too small");
+            }
+
+            std::memcpy(&footer, bytes.data() + bytes.size() - sizeof(footer), sizeof(footer));
+
+            // The index is exactly between indexOffset and the footer,
+            // computed without overflows whatever the footer holds
+            uint64_t indexEnd = bytes.size() - sizeof(footer);
+            uint64_t indexBytes = indexEnd - footer.indexOffset;
+
+            if (footer.magic != ArchiveFooter::MAGIC || footer.indexOffset > indexEnd ||
+                indexBytes % sizeof(uint64_t) != 0 || indexBytes / sizeof(uint64_t) != footer.recordsCount + 1 ||
+                footer.recordsCount == std::numeric_limits<uint64_t>::max())
+            {
+                throw std::runtime_error("archive is corrupted");
+            }
+
+            _recordsCount = footer.recordsCount;
+            _indexOffset = footer.indexOffset;
+            _index = bytes.data() + footer.indexOffset;
+        }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept { return _recordsCount; }
+
+        [[nodiscard]]
+        std::span<const SerDes::SerializedData::Memory> record(size_t n) const
+        {
+            if (n >= _recordsCount)
+            {
+                throw std::out_of_range("no such record in archive");
+            }
+
+            uint64_t offset = offsetAt(n);
+            uint64_t next = offsetAt(n + 1);
+
+            if (offset > next || next > _indexOffset)
+            {
+                throw std::runtime_error("archive is corrupted");
+            }
+
+            return _file.bytes().subspan(offset, next - offset);
+        }
+
+        void read(size_t n, SerDes& record) const { record.deserializeFrom(this->record(n)); }
+
+    private :
+        MappedFile _file;
+        size_t _recordsCount;
+        uint64_t _indexOffset;
+        const std::byte *_index;
+
+        [[nodiscard]]
+        inline uint64_t offsetAt(size_t n) const noexcept
+        {
+            return loadUnaligned<uint64_t>(_index + n * sizeof(uint64_t));
+        }
+    };
+
+    /* Overlay format for structs of arithmetic fields, read in place instead
+       of being deserialized : records are laid out like C structs, each field
+       at an offset multiple of its alignment and the record size a multiple of
+       the biggest one, padding bytes being zeroed. Integers and floats are
+       stored little endian whatever the host. A block is an OverlayHeader then
+       the records; blocks start on OVERLAY_ALIGNMENT boundaries, so fields of
+       a block at the beginning of a mapped file are read with aligned loads */
+    constexpr std::endian OVERLAY_ENDIANNESS = std::endian::little;
+    constexpr size_t OVERLAY_ALIGNMENT = 16;
+
+    // Converts between host and overlay endianness, both ways
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    [[nodiscard]]
+    constexpr T convertOverlayEndianness(T value) noexcept
+    {
+        if constexpr (std::endian::native == OVERLAY_ENDIANNESS || sizeof(T) == 1)
+        {
+            return value;
+        }
+        else
+        {
+            auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+
+            std::ranges::reverse(bytes);
+
+            return std::bit_cast<T>(bytes);
+        }
+    }
+
+    template <Columnar T>
+    struct OverlayLayout
+    {
+        static constexpr size_t FIELDS_TOTAL = std::tuple_size_v<decltype(T::fields)>;
+
+        static constexpr size_t alignment = std::apply([](auto... fieldPtrs)
+        {
+            return std::max({alignof(ColumnType_t<T, decltype(fieldPtrs)>)...});
+        }, T::fields);
+
+        static constexpr std::array<size_t, FIELDS_TOTAL> offsets = []()
+        {
+            std::array<size_t, FIELDS_TOTAL> fieldOffsets{};
+            size_t offset = 0;
+            size_t index = 0;
+
+            std::apply([&](auto... fieldPtrs)
+            {
+                ((offset = alignUp(offset, alignof(ColumnType_t<T, decltype(fieldPtrs)>)),
+                  fieldOffsets[index++] = offset,
+                  offset += sizeof(ColumnType_t<T, decltype(fieldPtrs)>)), ...);
+            }, T::fields);
+
+            return fieldOffsets;
+        }();
+
+        static constexpr size_t size = alignUp(
+            offsets.back() + sizeof(ColumnType_t<T, std::tuple_element_t<FIELDS_TOTAL - 1, decltype(T::fields)>>),
+            alignment);
+
+        static_assert(alignment <= OVERLAY_ALIGNMENT, "records wouldn't be aligned in a block");
+    };
+
+    struct OverlayHeader
+    {
+        static constexpr uint32_t MAGIC = 0x4f564c59;
+
+        uint32_t magic;
+        // Checked against the layout of the records read
+        uint32_t recordSize;
+        uint64_t count;
+    };
+
+    static_assert(sizeof(OverlayHeader) % OVERLAY_ALIGNMENT == 0, "records must stay aligned");
+
+    // Appends a block holding objects to buffer, returns the offset of the block in it
+    template <Columnar T>
+    size_t serializeOverlay(std::span<const T> objects, SerDes::OutputBuffer& buffer)
+    {
+        using Layout_t = OverlayLayout<T>;
+
+        // Aligned from the beginning of the buffer
+        std::ranges::fill(buffer.append(alignUp(buffer.size(), OVERLAY_ALIGNMENT) - buffer.size()),
+                          std::byte(0));
+
+        size_t offset = buffer.size();
+        auto *ptr = buffer.append(sizeof(OverlayHeader) + objects.size() * Layout_t::size).data();
+        OverlayHeader header
+        {
+            convertOverlayEndianness(OverlayHeader::MAGIC),
+            convertOverlayEndianness(static_cast<uint32_t>(Layout_t::size)),
+            convertOverlayEndianness(static_cast<uint64_t>(objects.size()))
+        };
+
+        std::memcpy(ptr, &header, sizeof(header));
+        ptr += sizeof(header);
+
+        for (const T& object : objects)
+        {
+            std::memset(ptr, 0, Layout_t::size);
+
+            std::apply([&](auto... fieldPtrs)
+            {
+                size_t index = 0;
+
+                ([&](auto value)
+                {
+                    value = convertOverlayEndianness(value);
+                    std::memcpy(ptr + Layout_t::offsets[index++], &value, sizeof(value));
+                }(object.*fieldPtrs), ...);
+            }, T::fields);
+
+            ptr += Layout_t::size;
+        }
+
+        return offset;
+    }
+
+    // Record of an overlay block, each field is read in place when asked for
+    template <Columnar T>
+    class OverlayView
+    {
+    public :
+        template <size_t Index>
+        using Field_t = ColumnType_t<T, std::tuple_element_t<Index, decltype(T::fields)>>;
+
+        explicit OverlayView(const std::byte *record) noexcept : _record(record)
+        {
+            assertm(reinterpret_cast<uintptr_t>(record) % OverlayLayout<T>::alignment == 0,
+                    "Record is misaligned");
+        }
+
+        template <size_t Index>
+        [[nodiscard]]
+        Field_t<Index> get() const noexcept
+        {
+            // memcpy() of an aligned value compiles to a single aligned load
+            const auto *field = std::assume_aligned<alignof(Field_t<Index>)>(
+                _record + OverlayLayout<T>::offsets[Index]);
+            Field_t<Index> value;
+
+            std::memcpy(&value, field, sizeof(value));
+
+            return convertOverlayEndianness(value);
+        }
+
+        void materialize(T& object) const noexcept
+        {
+            [&]<size_t... Indexes>(std::index_sequence<Indexes...>)
+            {
+                ((object.*std::get<Indexes>(T::fields) = get<Indexes>()), ...);
+            }(std::make_index_sequence<OverlayLayout<T>::FIELDS_TOTAL>());
+        }
+
+    private :
+        const std::byte *_record;
+    };
+
+    // Records of an overlay block, validated once when created
+    template <Columnar T>
+    class OverlayArray
+    {
+    public :
+        explicit OverlayArray(std::span<const SerDes::SerializedData::Memory> block)
+        {
+            if (reinterpret_cast<uintptr_t>(block.data()) % OVERLAY_ALIGNMENT != 0)
+            {
+                throw std::runtime_error("overlay block is misaligned");
+            }
+
+            if (block.size() < sizeof(OverlayHeader))
+            {
+                throw std::runtime_error("overlay block is truncated");
+            }
+
+            OverlayHeader header;
+
+            std::memcpy(&header, block.data(), sizeof(header));
+
+            if (convertOverlayEndianness(header.magic) != OverlayHeader::MAGIC ||
+                convertOverlayEndianness(header.recordSize) != OverlayLayout<T>::size)
+            {
+                throw std::runtime_error("overlay block doesn't hold such records");
+            }
+
+            _size = convertOverlayEndianness(header.count);
+            _records = block.data() + sizeof(header);
+
+            if ((block.size() - sizeof(header)) / OverlayLayout<T>::size < _size)
+            {
+                throw std::runtime_error("overlay block is truncated");
+            }
+        }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept { return _size; }
+
+        [[nodiscard]]
+        inline bool empty() const noexcept { return _size == 0; }
+
+        [[nodiscard]]
+        inline OverlayView<T> operator[](size_t n) const noexcept
+        {
+            return OverlayView<T>(_records + n * OverlayLayout<T>::size);
+        }
+
+    private :
+        const std::byte *_records;
+        size_t _size;
+    };
+
+    // Returns the average time in nanoseconds of one call of func
+    template <typename Func>
+    double measureNsPerOp(size_t nbOps, Func&& func)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t n = 0; n < nbOps; ++n)
+        {
+            func();
+        }
+
+        std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        return elapsed.count() / nbOps;
+    }
+}
+
+TEST(SerializationTest, TestStruct_1)
+{
+    using SerializedData = Struct_1::SerializedData;
+
+    Struct_1 structToSerialize{42, 84.5, 245.2};
+    SerializedData data = structToSerialize.serialize();
+    Struct_1 structToDeserialize;
+
+    structToDeserialize.deserialize(data);
+    EXPECT_EQ(structToDeserialize.n, 42);
+    EXPECT_EQ(structToDeserialize.f, 84.5);
+    EXPECT_EQ(structToDeserialize.d, 245.2);
+}
+
+TEST(SerializationTest, TestStruct_2)
+{
+    using SerializedData = Struct_2::SerializedData;
+
+    Struct_2 structToSerialize{42, 'a', "Hello World !"};
+    SerializedData data = structToSerialize.serialize();
+    Struct_2 structToDeserialize;
+
+    structToDeserialize.deserialize(data);
+    EXPECT_EQ(structToDeserialize.n, 42);
+    EXPECT_EQ(structToDeserialize.c, 'a');
+    EXPECT_EQ(structToDeserialize.s, "Hello World !");
+}
+
+TEST(SerializationTest, TestStruct_3)
+{
+    using SerializedData = Struct_3::SerializedData;
+
+    Struct_3 structToSerialize{3, {{8, "abcd" }, {2, "efgh"}, {253, "AETOP"}}};
+    SerializedData data = structToSerialize.serialize();
+    Struct_3 structToDeserialize;
+
+    structToDeserialize.deserialize(data);
+    EXPECT_EQ(structToDeserialize.s, 3);
+    EXPECT_THAT(structToDeserialize.m,
+                ElementsAre(Pair(2, "efgh"), Pair(8, "abcd"), Pair(253, "AETOP")));
+}
+
+TEST(SerializationTest, TestAllStructsWithVirtualisation)
+{
+    using SerializedData = SerDes::SerializedData;
+
+    std::array<std::unique_ptr<SerDes>, 3> serializers;
+
+    serializers[0] = std::make_unique<Struct_1>(
+        10, 21.0, 57.7);
+    serializers[1] = std::make_unique<Struct_2>(
+        411, 'W', "WaWaZa");
+    serializers[2] = std::make_unique<Struct_3>(
+        15, std::map<int, std::string>{{1000, "ASD"}, {478, "GgH"}});
+
+    std::array<SerializedData, serializers.size()> datas;
+
+    for (uint32_t n = 0; n < serializers.size(); ++n)
+    {
+        datas[n] = serializers[n]->serialize();
+    }
+
+    std::array<std::unique_ptr<SerDes>, datas.size()> deserializers;
+
+    deserializers[0] = std::make_unique<Struct_1>();
+    deserializers[1] = std::make_unique<Struct_2>();
+    deserializers[2] = std::make_unique<Struct_3>();
+
+    for (uint32_t n = 0; n < datas.size(); ++n)
+    {
+        deserializers[n]->deserialize(datas[n]);
+    }
+
+    const auto& deserializedStruct_1 = static_cast<Struct_1&>(*deserializers[0]);
+
+    EXPECT_EQ(deserializedStruct_1.n, 10);
+    EXPECT_EQ(deserializedStruct_1.f, 21.0);
+    EXPECT_EQ(deserializedStruct_1.d, 57.7);
+
+    const auto& deserializedStruct_2 = static_cast<Struct_2&>(*deserializers[1]);
+
+    EXPECT_EQ(deserializedStruct_2.n, 411);
+    EXPECT_EQ(deserializedStruct_2.c, 'W');
+    EXPECT_EQ(deserializedStruct_2.s, "WaWaZa");
+
+    const auto& deserializedStruct_3 = static_cast<Struct_3&>(*deserializers[2]);
+
+    EXPECT_EQ(deserializedStruct_3.s, 15);
+    EXPECT_THAT(deserializedStruct_3.m, ElementsAre(Pair(478, "GgH"), Pair(1000, "ASD")));
+}
+
+namespace
+{
+    struct Point
+    {
+        double x;
+        double y;
+
+        static constexpr auto fields = std::tuple{&Point::x, &Point::y};
+    };
+
+    struct Shape
+    {
+        std::string name;
+        std::map<std::string, Point> points;
+        Point origin;
+        uint8_t flags;
+
+        static constexpr auto fields =
+            std::tuple{&Shape::name, &Shape::points, &Shape::origin, &Shape::flags};
+    };
+
+    [[nodiscard]]
+    bool haveSameBytes(const SerDes::SerializedData& data,
+                       const SerDes::SerializedData& data2) noexcept
+    {
+        return data.size == data2.size &&
+            std::memcmp(data.data.get(), data2.data.get(), data.size) == 0;
+    }
+}
+
+TEST(SerializationTest, TestSchemaMatchesHandwritten)
+{
+    Struct_1 struct_1{42, 84.5, 245.2};
+    Struct_2 struct_2{42, 'a', "Hello World !"};
+    Struct_3 struct_3{3, {{8, "abcd" }, {2, "efgh"}, {253, "AETOP"}}};
+
+    EXPECT_TRUE(haveSameBytes(serializeWithSchema(struct_1), struct_1.serialize()));
+    EXPECT_TRUE(haveSameBytes(serializeWithSchema(struct_2), struct_2.serialize()));
+    EXPECT_TRUE(haveSameBytes(serializeWithSchema(struct_3), struct_3.serialize()));
+
+    Struct_3 structToDeserialize;
+
+    deserializeWithSchema(structToDeserialize, struct_3.serialize());
+    EXPECT_EQ(structToDeserialize.s, 3);
+    EXPECT_THAT(structToDeserialize.m,
+                ElementsAre(Pair(2, "efgh"), Pair(8, "abcd"), Pair(253, "AETOP")));
+}
+
+TEST(SerializationTest, TestSchemaNestedStructs)
+{
+    Shape shape{"triangle", {{"a", {0, 0}}, {"b", {1, 0}}, {"c", {0.5, 1}}}, {-1, 2.5}, 7};
+    Shape deserializedShape;
+
+    deserializeWithSchema(deserializedShape, serializeWithSchema(shape));
+    EXPECT_EQ(deserializedShape.name, "triangle");
+    ASSERT_EQ(deserializedShape.points.size(), 3);
+    EXPECT_EQ(deserializedShape.points.at("c").x, 0.5);
+    EXPECT_EQ(deserializedShape.points.at("c").y, 1);
+    EXPECT_EQ(deserializedShape.origin.x, -1);
+    EXPECT_EQ(deserializedShape.origin.y, 2.5);
+    EXPECT_EQ(deserializedShape.flags, 7);
+}
+
+namespace
+{
+    thread_local size_t globalAllocationsCount = 0;
+}
+
+// Counting operator new, as in CustomizedQueueTest.cpp, new not inlined either
+[[gnu::noinline]]
+void *operator new(size_t size)
+{
+    ++globalAllocationsCount;
+
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]]
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+[[gnu::noinline]]
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+TEST(SerializationTest, TestStruct_2View)
+{
+    std::optional<Struct_2View> view;
+
+    {
+        Struct_2 structToSerialize{42, 'a', "Hello World !"};
+
+        view.emplace(std::make_shared<const SerDes::SerializedData>(
+            structToSerialize.serialize()));
+    }
+
+    // The view keeps the serialized data alive
+    EXPECT_EQ(view->n(), 42);
+    EXPECT_EQ(view->c(), 'a');
+    EXPECT_EQ(view->s(), "Hello World !");
+
+    // The string length says more bytes than there are left
+    auto data = Struct_2{42, 'a', "Hello World !"}.serialize();
+    auto truncated = std::make_shared<SerDes::SerializedData>(
+        data.size - 1, std::make_unique<SerDes::SerializedData::Memory[]>(data.size - 1));
+
+    std::memcpy(truncated->data.get(), data.data.get(), truncated->size);
+    EXPECT_THROW(Struct_2View{truncated}, std::runtime_error);
+}
+
+TEST(SerializationTest, TestStruct_3View)
+{
+    Struct_3 structToSerialize{3, {{8, "abcd" }, {2, "efgh"}, {253, "AETOP"}}};
+    Struct_3View view(std::make_shared<const SerDes::SerializedData>(
+        structToSerialize.serialize()));
+    const auto& m = view.m();
+    size_t globalAllocationsBefore = globalAllocationsCount;
+
+    EXPECT_EQ(view.s(), 3);
+    EXPECT_EQ(m.size(), 3);
+    EXPECT_EQ(m.lookup(8), "abcd");
+    EXPECT_EQ(m.lookup(253), "AETOP");
+    EXPECT_EQ(m.lookup(2), "efgh");
+    EXPECT_EQ(m.lookup(5), std::nullopt);
+    EXPECT_EQ(m.lookup(1000), std::nullopt);
+    EXPECT_EQ(m.find(5), m.end());
+    EXPECT_EQ(m.find(8)->second, "abcd");
+    EXPECT_EQ(globalAllocationsCount, globalAllocationsBefore);
+    EXPECT_THAT(m, ElementsAre(Pair(2, "efgh"), Pair(8, "abcd"), Pair(253, "AETOP")));
+
+    Struct_3View emptyMapView(std::make_shared<const SerDes::SerializedData>(
+        Struct_3{-1, {}}.serialize()));
+
+    EXPECT_EQ(emptyMapView.s(), -1);
+    EXPECT_TRUE(emptyMapView.m().empty());
+    EXPECT_EQ(emptyMapView.m().begin(), emptyMapView.m().end());
+
+    // Entries are decoded on demand, only the last one is truncated
+    auto data = structToSerialize.serialize();
+    auto truncated = std::make_shared<SerDes::SerializedData>(
+        data.size - 1, std::make_unique<SerDes::SerializedData::Memory[]>(data.size - 1));
+
+    std::memcpy(truncated->data.get(), data.data.get(), truncated->size);
+
+    Struct_3View truncatedView(truncated);
+
+    EXPECT_EQ(truncatedView.m().lookup(2), "efgh");
+    EXPECT_THROW({ [[maybe_unused]] auto _ = truncatedView.m().lookup(253); }, std::runtime_error);
+}
+
+TEST(SerializationTest, TestSerializeIntoBuffer)
+{
+    using SerializedData = SerDes::SerializedData;
+
+    Struct_2 structToSerialize{42, 'a', "Hello World !"};
+    SerDes::OutputBuffer buffer;
+
+    EXPECT_EQ(structToSerialize.serialize(buffer), 0);
+    EXPECT_EQ(structToSerialize.serialize(buffer), structToSerialize.serializedSize());
+    ASSERT_EQ(buffer.size(), 2 * structToSerialize.serializedSize());
+    EXPECT_TRUE(std::ranges::equal(buffer.bytes().first(buffer.size() / 2),
+                                   buffer.bytes().last(buffer.size() / 2)));
+
+    // Reused without any new allocation
+    size_t capacity = buffer.capacity();
+    size_t globalAllocationsBefore = globalAllocationsCount;
+
+    buffer.clear();
+    structToSerialize.serialize(buffer);
+    EXPECT_EQ(buffer.capacity(), capacity);
+    EXPECT_EQ(globalAllocationsCount, globalAllocationsBefore);
+
+    std::array<SerializedData::Memory, 64> array;
+    size_t size = structToSerialize.serializeInto(array);
+    SerializedData data{size, std::make_unique<SerializedData::Memory[]>(size)};
+    Struct_2 structToDeserialize;
+
+    std::memcpy(data.data.get(), array.data(), size);
+    structToDeserialize.deserialize(data);
+    EXPECT_EQ(structToDeserialize.n, 42);
+    EXPECT_EQ(structToDeserialize.c, 'a');
+    EXPECT_EQ(structToDeserialize.s, "Hello World !");
+}
+
+TEST(SerializationTest, TestSerializeAllInOneBuffer)
+{
+    std::array<std::unique_ptr<SerDes>, 3> serializers;
+
+    serializers[0] = std::make_unique<Struct_1>(
+        10, 21.0, 57.7);
+    serializers[1] = std::make_unique<Struct_2>(
+        411, 'W', "WaWaZa");
+    serializers[2] = std::make_unique<Struct_3>(
+        15, std::map<int, std::string>{{1000, "ASD"}, {478, "GgH"}});
+
+    SerDes::OutputBuffer buffer;
+
+    [[maybe_unused]] auto _ = buffer.append(5);
+
+    std::vector<size_t> offsets = serializeAll(serializers, buffer);
+
+    ASSERT_EQ(offsets.size(), serializers.size());
+    EXPECT_EQ(offsets[0], 5);
+
+    for (uint32_t n = 0; n < serializers.size(); ++n)
+    {
+        auto data = serializers[n]->serialize();
+
+        ASSERT_LE(offsets[n] + data.size, buffer.size());
+        EXPECT_EQ(std::memcmp(buffer.bytes().data() + offsets[n], data.data.get(), data.size), 0);
+    }
+
+    EXPECT_EQ(buffer.size(), offsets.back() + serializers.back()->serializedSize());
+}
+
+namespace
+{
+    struct Integers
+    {
+        int64_t i64;
+        uint64_t u64;
+        int16_t i16;
+        uint32_t u32;
+        char c;
+        float f;
+
+        static constexpr auto fields = std::tuple{
+            &Integers::i64, &Integers::u64, &Integers::i16,
+            &Integers::u32, &Integers::c, &Integers::f};
+    };
+}
+
+TEST(SerializationTest, TestCompactEncoding)
+{
+    auto roundTrip = [](const Integers& integers)
+    {
+        Integers deserialized;
+        auto data = serializeWithSchema<Encoding::Compact>(integers);
+
+        deserializeWithSchema<Encoding::Compact>(deserialized, data);
+        EXPECT_EQ(deserialized.i64, integers.i64);
+        EXPECT_EQ(deserialized.u64, integers.u64);
+        EXPECT_EQ(deserialized.i16, integers.i16);
+        EXPECT_EQ(deserialized.u32, integers.u32);
+        EXPECT_EQ(deserialized.c, integers.c);
+        EXPECT_EQ(deserialized.f, integers.f);
+
+        return data.size;
+    };
+
+    // Varints of 1 byte, then 2 bytes for each integer, plus char and float
+    EXPECT_EQ(roundTrip({0, 0, 0, 0, 'a', 1.5}), 4 + 1 + 4);
+    EXPECT_EQ(roundTrip({-1, 127, 63, 127, 'b', -2}), 4 + 1 + 4);
+    EXPECT_EQ(roundTrip({-64, 128, -65, 16383, 'c', 0}), 1 + 2 + 2 + 2 + 1 + 4);
+    EXPECT_EQ(roundTrip({64, 16384, 8191, 16384, 'd', 0}), 2 + 3 + 2 + 3 + 1 + 4);
+    EXPECT_EQ(roundTrip({INT64_MIN,
+                         UINT64_MAX,
+                         INT16_MIN,
+                         UINT32_MAX,
+                         CHAR_MIN,
+                         std::numeric_limits<float>::max()}), 10 + 10 + 3 + 5 + 1 + 4);
+    roundTrip({INT64_MAX, 1ULL << 63, INT16_MAX, 1U << 31, CHAR_MAX, -0.f});
+
+    Struct_3 struct_3{3, {{8, "abcd" }, {2, "efgh"}, {253, "AETOP"}}};
+    auto data = serializeWithSchema<Encoding::Compact>(struct_3);
+    Struct_3 structToDeserialize;
+
+    // short, entries count, then keys and lengths all fit in 1 or 2 bytes
+    EXPECT_EQ(data.size, 1 + 1 + (1 + 1 + 4) + (1 + 1 + 4) + (2 + 1 + 5));
+    EXPECT_LT(data.size, struct_3.serializedSize());
+    deserializeWithSchema<Encoding::Compact>(structToDeserialize, data);
+    EXPECT_EQ(structToDeserialize.s, 3);
+    EXPECT_THAT(structToDeserialize.m,
+                ElementsAre(Pair(2, "efgh"), Pair(8, "abcd"), Pair(253, "AETOP")));
+
+    // Cut anywhere, including in the middle of a varint
+    for (size_t size = 1; size < data.size; ++size)
+    {
+        SerDes::SerializedData truncated{size, std::make_unique<SerDes::SerializedData::Memory[]>(size)};
+
+        std::memcpy(truncated.data.get(), data.data.get(), size);
+        EXPECT_THROW(deserializeWithSchema<Encoding::Compact>(structToDeserialize, truncated),
+                     std::runtime_error);
+    }
+
+    // Continuation bits set on more bytes than a 64 bits varint can take
+    SerDes::SerializedData unterminated{32, std::make_unique<SerDes::SerializedData::Memory[]>(32)};
+    Integers integers;
+
+    std::ranges::fill(std::span(unterminated.data.get(), unterminated.size), std::byte{0x80});
+    EXPECT_THROW(deserializeWithSchema<Encoding::Compact>(integers, unterminated), std::runtime_error);
+}
+
+namespace
+{
+    // File path in the temporary directory, removed on destruction
+    class TemporaryFile
+    {
+    public :
+        TemporaryFile()
+        {
+            std::string path = (std::filesystem::temp_directory_path() /
+                                "SerializationTest.XXXXXX").string();
+            int fd = ::mkstemp(path.data());
+
+            if (fd == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), "mkstemp");
+            }
+
+            ::close(fd);
+            _path = path;
+        }
+
+        TemporaryFile(const TemporaryFile&) = delete;
+        TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+        ~TemporaryFile() { std::filesystem::remove(_path); }
+
+        [[nodiscard]]
+        inline const std::filesystem::path& path() const noexcept { return _path; }
+
+    private :
+        std::filesystem::path _path;
+    };
+}
+
+TEST(SerializationTest, TestRecordWriterAndReader)
+{
+    constexpr int RECORDS_TOTAL = 3000;
+    TemporaryFile file;
+
+    {
+        // Small batches and chunks to go through several writev() and read()
+        RecordWriter writer(file.path(), 256);
+
+        for (int n = 0; n < RECORDS_TOTAL; ++n)
+        {
+            writer.write(Struct_2(n, 'a' + n % 26, std::string(n % 300, 'x')));
+
+            if (n == RECORDS_TOTAL / 2)
+            {
+                writer.flush();
+            }
+        }
+
+        writer.write(SerDes::SerializedData{0, nullptr});
+    }
+
+    RecordReader reader(file.path(), 128);
+
+    for (int n = 0; n < RECORDS_TOTAL; ++n)
+    {
+        auto data = reader.next();
+        Struct_2 record;
+
+        ASSERT_TRUE(data);
+        record.deserialize(*data);
+        ASSERT_EQ(record.n, n);
+        ASSERT_EQ(record.c, 'a' + n % 26);
+        ASSERT_EQ(record.s, std::string(n % 300, 'x'));
+    }
+
+    auto emptyRecord = reader.next();
+
+    ASSERT_TRUE(emptyRecord);
+    EXPECT_EQ(emptyRecord->size, 0);
+    EXPECT_EQ(reader.next(), std::nullopt);
+}
+
+TEST(SerializationTest, TestRecordReaderTruncatedFrame)
+{
+    TemporaryFile file;
+
+    {
+        RecordWriter writer(file.path());
+
+        writer.write(Struct_1(1, 2, 3));
+        writer.write(Struct_1(4, 5, 6));
+    }
+
+    std::filesystem::resize_file(file.path(), std::filesystem::file_size(file.path()) - 1);
+
+    RecordReader reader(file.path());
+
+    EXPECT_TRUE(reader.next());
+    EXPECT_THROW({ [[maybe_unused]] auto _ = reader.next(); }, std::runtime_error);
+}
+
+TEST(SerializationTest, TestRecordReaderCorruptedFrame)
+{
+    TemporaryFile file;
+
+    {
+        RecordWriter writer(file.path());
+
+        writer.write(Struct_2(1, 'a', "abcdef"));
+        writer.write(Struct_2(2, 'b', "ghijkl"));
+    }
+
+    {
+        // Flips one bit of the last payload byte
+        std::fstream stream(file.path(), std::ios::in | std::ios::out | std::ios::binary);
+        char byte;
+
+        stream.seekg(-1, std::ios::end);
+        stream.get(byte);
+        stream.seekp(-1, std::ios::end);
+        stream.put(static_cast<char>(byte ^ 0x10));
+    }
+
+    RecordReader reader(file.path());
+
+    EXPECT_TRUE(reader.next());
+    EXPECT_THROW({ [[maybe_unused]] auto _ = reader.next(); }, std::runtime_error);
+}
+
+TEST(SerializationTest, TestRecordReaderCorruptedFrameHeader)
+{
+    TemporaryFile file;
+
+    {
+        RecordWriter writer(file.path());
+
+        writer.write(Struct_2(1, 'a', "abcdef"));
+    }
+
+    // Overwrites one field of the header then reads the frame back
+    auto readWithHeaderField = [&file](std::streamoff offset, auto value)
+    {
+        {
+            std::fstream stream(file.path(), std::ios::in | std::ios::out | std::ios::binary);
+
+            stream.seekp(offset);
+            stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        RecordReader reader(file.path());
+
+        return reader.next();
+    };
+
+    auto size = std::filesystem::file_size(file.path()) - sizeof(FrameHeader);
+
+    EXPECT_TRUE(readWithHeaderField(0, uint64_t{size}));
+    // Bigger than the file, rejected before allocating
+    EXPECT_THROW(readWithHeaderField(0, uint64_t{1} << 60), std::runtime_error);
+    // Within the file, caught by the checksum
+    EXPECT_THROW(readWithHeaderField(0, uint64_t{size - 1}), std::runtime_error);
+    EXPECT_TRUE(readWithHeaderField(0, uint64_t{size}));
+    EXPECT_THROW(readWithHeaderField(offsetof(FrameHeader, reserved), uint32_t{1}), std::runtime_error);
+}
+
+TEST(SerializationTest, TestRecordWriterWriteError)
+{
+    {
+        RecordWriter writer("/dev/full");
+
+        writer.write(Struct_1(1, 2, 3));
+        EXPECT_THROW(writer.close(), std::system_error);
+        EXPECT_NO_THROW(writer.close());
+    }
+
+    // Not closed, the error is lost but the program goes on
+    {
+        RecordWriter writer("/dev/full");
+
+        writer.write(Struct_1(1, 2, 3));
+    }
+}
+
+TEST(SerializationTest, TestCrc32c)
+{
+    std::string_view check = "123456789";
+    auto checkBytes = std::as_bytes(std::span(check));
+
+    EXPECT_EQ(crc32c({}), 0);
+    EXPECT_EQ(crc::software(checkBytes), 0xe3069283);
+    EXPECT_EQ(crc32c(checkBytes), 0xe3069283);
+    EXPECT_EQ(crc32c(checkBytes.subspan(4), crc32c(checkBytes.first(4))), 0xe3069283);
+
+    std::vector<std::byte> bytes(4 * crc::LONG_LANE);
+    std::minstd_rand random(42);
+
+    std::ranges::generate(bytes, [&random]() { return static_cast<std::byte>(random()); });
+
+    // Through the long and short lanes, unaligned, and cut in two parts
+    for (size_t size : {0ul, 7ul, 8ul, 3 * crc::SHORT_LANE - 1, 3 * crc::SHORT_LANE + 13,
+                        3 * crc::LONG_LANE, 3 * crc::LONG_LANE + 3 * crc::SHORT_LANE + 5})
+    {
+        auto data = std::span(bytes).subspan(3, size);
+        uint32_t expected = crc::software(data);
+
+        ASSERT_EQ(crc32c(data), expected) << "size=" << size;
+        ASSERT_EQ(crc32c(data.subspan(size / 3), crc32c(data.first(size / 3))), expected);
+    }
+}
+
+TEST(SerializationTest, TestArchive)
+{
+    constexpr size_t RECORDS_TOTAL = 3000;
+    TemporaryFile file;
+
+    {
+        ArchiveWriter writer(file.path());
+
+        for (size_t n = 0; n < RECORDS_TOTAL; ++n)
+        {
+            int value = static_cast<int>(n);
+            size_t index = n % 3 == 0 ? writer.append(Struct_1(value, 0.5f * value, 0.25 * value))
+                         : n % 3 == 1 ? writer.append(Struct_2(value, 'a' + n % 26, std::string(n % 100, 'x')))
+                         : writer.append(Struct_3(static_cast<short>(n), {{value, "abc"}, {-value, "de"}}));
+
+            ASSERT_EQ(index, n);
+        }
+    }
+
+    ArchiveReader reader(file.path());
+
+    ASSERT_EQ(reader.size(), RECORDS_TOTAL);
+
+    // Random access, backwards
+    for (size_t n = RECORDS_TOTAL; n-- > 0;)
+    {
+        int value = static_cast<int>(n);
+
+        if (n % 3 == 0)
+        {
+            Struct_1 record;
+
+            reader.read(n, record);
+            ASSERT_EQ(record.n, value);
+            ASSERT_EQ(record.f, 0.5f * value);
+            ASSERT_EQ(record.d, 0.25 * value);
+        }
+        else if (n % 3 == 1)
+        {
+            Struct_2 record;
+
+            reader.read(n, record);
+            ASSERT_EQ(record.n, value);
+            ASSERT_EQ(record.c, 'a' + n % 26);
+            ASSERT_EQ(record.s, std::string(n % 100, 'x'));
+        }
+        else
+        {
+            Struct_3 record;
+
+            reader.read(n, record);
+            ASSERT_EQ(record.s, static_cast<short>(n));
+            ASSERT_EQ(record.m, (std::map<int, std::string>{{value, "abc"}, {-value, "de"}}));
+        }
+    }
+
+    EXPECT_EQ(reader.record(0).size(), Struct_1().serializedSize());
+    EXPECT_THROW({ [[maybe_unused]] auto _ = reader.record(RECORDS_TOTAL); }, std::out_of_range);
+}
+
+TEST(SerializationTest, TestArchiveCorrupted)
+{
+    TemporaryFile file;
+
+    {
+        ArchiveWriter writer(file.path());
+
+        writer.append(Struct_1(1, 2, 3));
+    }
+
+    EXPECT_EQ(ArchiveReader(file.path()).size(), 1);
+
+    // Overwrites the value at offset from the end of the archive
+    auto overwriteFromEnd = [&file](std::streamoff offset, uint64_t value)
+    {
+        std::fstream stream(file.path(), std::ios::in | std::ios::out | std::ios::binary);
+
+        stream.seekp(-offset, std::ios::end);
+        stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+
+    // End of the record, last entry of the index, out of the records
+    overwriteFromEnd(sizeof(ArchiveFooter) + sizeof(uint64_t), 1 << 20);
+    EXPECT_THROW({ [[maybe_unused]] auto _ = ArchiveReader(file.path()).record(0); }, std::runtime_error);
+
+    // Records count overflowing the index size computation
+    overwriteFromEnd(sizeof(ArchiveFooter), (uint64_t{1} << 61) + 1);
+    EXPECT_THROW({ ArchiveReader reader(file.path()); }, std::runtime_error);
+
+    std::filesystem::resize_file(file.path(), std::filesystem::file_size(file.path()) - 1);
+    EXPECT_THROW({ ArchiveReader reader(file.path()); }, std::runtime_error);
+
+    std::filesystem::resize_file(file.path(), 0);
+    EXPECT_THROW({ ArchiveReader reader(file.path()); }, std::runtime_error);
+}
+
+TEST(SerializationTest, TestArchiveWriterWriteError)
+{
+    ArchiveWriter writer("/dev/full");
+
+    writer.append(Struct_1(1, 2, 3));
+    EXPECT_THROW(writer.close(), std::system_error);
+    EXPECT_NO_THROW(writer.close());
+}
+
+TEST(SerializationTest, TestColumnar)
+{
+    constexpr size_t RECORDS_TOTAL = 1001;
+    std::vector<Struct_1> objects;
+    SerDes::OutputBuffer buffer;
+
+    for (size_t n = 0; n < RECORDS_TOTAL; ++n)
+    {
+        int value = static_cast<int>(n);
+
+        objects.emplace_back(value, 0.5f * value, 0.25 * value);
+    }
+
+    Struct_2(-1, 'a', "").serialize(buffer);
+
+    size_t offset = serializeColumnar(std::span<const Struct_1>(objects), buffer);
+    const auto *batch = buffer.bytes().data() + offset;
+
+    // Aligned after the 13 bytes of Struct_2
+    ASSERT_EQ(offset, 16);
+    // count, n column padded to 8 bytes, f column padded to 8 bytes, d column
+    ASSERT_EQ(buffer.size() - offset, 8 + 4008 + 4008 + 8008);
+    EXPECT_EQ(columnarSize<Struct_1>(RECORDS_TOTAL), buffer.size() - offset);
+
+    int n;
+    float f;
+    double d;
+
+    std::memcpy(&n, batch + 8 + 1000 * sizeof(n), sizeof(n));
+    std::memcpy(&f, batch + 8 + 4008 + 1000 * sizeof(f), sizeof(f));
+    std::memcpy(&d, batch + 8 + 4008 + 4008 + 1000 * sizeof(d), sizeof(d));
+    EXPECT_EQ(n, 1000);
+    EXPECT_EQ(f, 500.0f);
+    EXPECT_EQ(d, 250.0);
+
+    std::vector<Struct_1> deserialized(3000);
+
+    EXPECT_EQ(deserializeColumnar(buffer.bytes().subspan(offset), deserialized),
+              buffer.size() - offset);
+    ASSERT_EQ(deserialized.size(), RECORDS_TOTAL);
+
+    for (size_t n = 0; n < RECORDS_TOTAL; ++n)
+    {
+        ASSERT_EQ(deserialized[n].n, objects[n].n);
+        ASSERT_EQ(deserialized[n].f, objects[n].f);
+        ASSERT_EQ(deserialized[n].d, objects[n].d);
+    }
+
+    buffer.clear();
+    serializeColumnar(std::span<const Struct_1>(), buffer);
+    EXPECT_EQ(buffer.size(), sizeof(uint64_t));
+    EXPECT_EQ(deserializeColumnar(buffer.bytes(), deserialized), sizeof(uint64_t));
+    EXPECT_TRUE(deserialized.empty());
+
+    // Truncated, then with a count overflowing the batch size computation
+    serializeColumnar(std::span<const Struct_1>(objects).first(3), buffer);
+
+    auto batchBytes = buffer.bytes().subspan(sizeof(uint64_t));
+    uint64_t hugeCount = (uint64_t{1} << 63) + 1;
+
+    EXPECT_THROW(deserializeColumnar(batchBytes.first(batchBytes.size() - 1), deserialized), std::runtime_error);
+    EXPECT_THROW(deserializeColumnar(batchBytes.first(4), deserialized), std::runtime_error);
+    std::memcpy(const_cast<std::byte *>(batchBytes.data()), &hugeCount, sizeof(hugeCount));
+    EXPECT_THROW(deserializeColumnar(batchBytes, deserialized), std::runtime_error);
+}
+
+TEST(SerializationTest, TestSerDesBatch)
+{
+    using Batch_t = SerDesBatch<Struct_1, Struct_2, Struct_3>;
+
+    Batch_t batch;
+    SerDes::OutputBuffer buffer;
+
+    batch.emplace_back<Struct_1>(10, 21.0, 57.7);
+    batch.emplace_back<Struct_2>(411, 'W', "WaWaZa");
+    batch.emplace_back<Struct_3>(15, std::map<int, std::string>{{1000, "ASD"}, {478, "GgH"}});
+    batch.emplace_back<Struct_1>(-1, -2, -3).n = 11;
+
+    std::ranges::fill(buffer.append(3), std::byte(0));
+
+    size_t offset = batch.serialize(buffer);
+
+    ASSERT_EQ(offset, 3);
+    ASSERT_EQ(buffer.size() - offset, batch.serializedSize());
+    // Type tag of the first object, right after the count
+    EXPECT_EQ(buffer.bytes()[offset + sizeof(Batch_t::Size_t)], std::byte(0));
+
+    Batch_t deserialized;
+
+    deserialized.emplace_back<Struct_2>();
+    EXPECT_EQ(deserialized.deserializeFrom(buffer.bytes().subspan(offset)), batch.serializedSize());
+    ASSERT_EQ(deserialized.size(), 4);
+
+    const auto& deserializedStruct_1 = std::get<Struct_1>(deserialized[0]);
+
+    EXPECT_EQ(deserializedStruct_1.n, 10);
+    EXPECT_EQ(deserializedStruct_1.f, 21.0);
+    EXPECT_EQ(deserializedStruct_1.d, 57.7);
+
+    const auto& deserializedStruct_2 = std::get<Struct_2>(deserialized[1]);
+
+    EXPECT_EQ(deserializedStruct_2.n, 411);
+    EXPECT_EQ(deserializedStruct_2.c, 'W');
+    EXPECT_EQ(deserializedStruct_2.s, "WaWaZa");
+
+    const auto& deserializedStruct_3 = std::get<Struct_3>(deserialized[2]);
+
+    EXPECT_EQ(deserializedStruct_3.s, 15);
+    EXPECT_THAT(deserializedStruct_3.m, ElementsAre(Pair(478, "GgH"), Pair(1000, "ASD")));
+    EXPECT_EQ(std::get<Struct_1>(deserialized[3]).n, 11);
+
+    // Type tag out of the set
+    std::vector<std::byte> corrupted(buffer.bytes().begin() + offset, buffer.bytes().end());
+
+    corrupted[sizeof(Batch_t::Size_t)] = std::byte(3);
+    EXPECT_THROW(deserialized.deserializeFrom(corrupted), std::runtime_error);
+    EXPECT_THROW(deserialized.deserializeFrom(buffer.bytes().subspan(offset, 20)), std::runtime_error);
+}
+
+namespace
+{
+    // Struct_3 records of a few hundred entries with keys and values from small sets
+    SerDes::OutputBuffer makeStruct_3Records(size_t recordsTotal)
+    {
+        static const std::array<std::string, 4> values = {"pending", "running", "done", "failed"};
+        SerDes::OutputBuffer buffer;
+        std::minstd_rand random(42);
+
+        for (size_t n = 0; n < recordsTotal; ++n)
+        {
+            Struct_3 record{static_cast<short>(n), {}};
+
+            for (size_t entry = 0; entry < 300; ++entry)
+            {
+                record.m.emplace(static_cast<int>(random() % 1000), values[random() % values.size()]);
+            }
+
+            record.serialize(buffer);
+        }
+
+        return buffer;
+    }
+}
+
+TEST(SerializationTest, TestBlockCompression)
+{
+    auto roundTrip = [](std::span<const std::byte> input)
+    {
+        auto compressed = compressBlock(input);
+        auto decompressed = decompressBlock({compressed.data.get(), compressed.size});
+
+        EXPECT_EQ(decompressed.size, input.size());
+        EXPECT_TRUE(std::ranges::equal(std::span(decompressed.data.get(), decompressed.size), input));
+
+        return compressed.size;
+    };
+
+    std::vector<std::byte> bytes(100'000);
+    std::minstd_rand random(42);
+
+    // Empty, shorter than a match, incompressible
+    roundTrip({});
+    roundTrip(std::span(bytes).first(10));
+    std::ranges::generate(bytes, [&random]() { return static_cast<std::byte>(random()); });
+    EXPECT_LE(roundTrip(bytes), lz::compressBound(bytes.size()));
+
+    // Runs of a single byte and of short patterns, overlapping their copy
+    for (size_t n = 0; n < bytes.size(); ++n)
+    {
+        bytes[n] = n < 50'000 ? std::byte('a') : static_cast<std::byte>(n % 3);
+    }
+
+    EXPECT_LT(roundTrip(bytes), 1000);
+
+    auto records = makeStruct_3Records(100);
+
+    EXPECT_LT(roundTrip(records.bytes()), records.size() / 2);
+
+    auto compressed = compressBlock(records.bytes());
+    std::span<const std::byte> compressedBytes(compressed.data.get(), compressed.size);
+
+    EXPECT_THROW({ [[maybe_unused]] auto _ = decompressBlock(compressedBytes.first(compressed.size - 1)); },
+                 std::runtime_error);
+    EXPECT_THROW({ [[maybe_unused]] auto _ = decompressBlock(compressedBytes.first(4)); },
+                 std::runtime_error);
+
+    // Any SerializedData, e.g. the payload of a stream frame
+    Struct_3 record;
+    auto serialized = Struct_3(3, {{1, "abc"}}).serialize();
+    auto compressedRecord = compressBlock({serialized.data.get(), serialized.size});
+
+    record.deserialize(decompressBlock({compressedRecord.data.get(), compressedRecord.size}));
+    EXPECT_EQ(record.s, 3);
+    EXPECT_THAT(record.m, ElementsAre(Pair(1, "abc")));
+}
+
+TEST(SerializationTest, TestLazyRecord)
+{
+    Struct_3 record{-7, {{8, "abcd"}, {2, "efgh"}, {253, "AETOP"}, {-40, ""}}};
+    SerDes::OutputBuffer buffer;
+
+    std::ranges::fill(buffer.append(5), std::byte(0));
+
+    size_t offset = serializeIndexed(record, buffer);
+    LazyRecord<Struct_3> lazyRecord(buffer.bytes().subspan(offset));
+    size_t globalAllocationsBefore = globalAllocationsCount;
+
+    EXPECT_EQ(lazyRecord.get<0>(), -7);
+    EXPECT_EQ(lazyRecord.count<1>(), 4);
+    EXPECT_EQ(lazyRecord.lookup<1>(5), std::nullopt);
+    EXPECT_EQ(lazyRecord.lookup<1>(-1000), std::nullopt);
+    EXPECT_EQ(lazyRecord.lookup<1>(1000), std::nullopt);
+    // Only what was looked up or decoded allocates
+    EXPECT_EQ(globalAllocationsCount, globalAllocationsBefore);
+    EXPECT_EQ(lazyRecord.lookup<1>(8), "abcd");
+    EXPECT_EQ(lazyRecord.lookup<1>(253), "AETOP");
+    EXPECT_EQ(lazyRecord.lookup<1>(2), "efgh");
+    EXPECT_EQ(lazyRecord.lookup<1>(-40), "");
+    EXPECT_EQ(lazyRecord.get<1>(), record.m);
+
+    Struct_3 materialized;
+
+    lazyRecord.materialize(materialized);
+    EXPECT_EQ(materialized.s, record.s);
+    EXPECT_EQ(materialized.m, record.m);
+
+    buffer.clear();
+    serializeIndexed(Struct_3{1, {}}, buffer);
+
+    LazyRecord<Struct_3> emptyMapRecord(buffer.bytes());
+
+    EXPECT_EQ(emptyMapRecord.get<0>(), 1);
+    EXPECT_EQ(emptyMapRecord.count<1>(), 0);
+    EXPECT_EQ(emptyMapRecord.lookup<1>(0), std::nullopt);
+    EXPECT_TRUE(emptyMapRecord.get<1>().empty());
+
+    buffer.clear();
+    serializeIndexed(record, buffer);
+
+    auto bytes = buffer.bytes();
+    auto *mutableBytes = const_cast<std::byte *>(bytes.data());
+    auto corrupt = [mutableBytes](size_t at, uint32_t value)
+    {
+        std::memcpy(mutableBytes + at, &value, sizeof(value));
+    };
+    constexpr size_t MAP_OFFSET = 3 * sizeof(uint32_t) + sizeof(short);
+    constexpr size_t VALUE_OFFSETS = MAP_OFFSET + sizeof(size_t) + 4 * sizeof(int);
+
+    EXPECT_THROW(LazyRecord<Struct_3>(bytes.first(8)), std::runtime_error);
+    // Cut within the keys
+    EXPECT_THROW({ [[maybe_unused]] auto _ = LazyRecord<Struct_3>(bytes.first(MAP_OFFSET + 12)).count<1>(); },
+                 std::runtime_error);
+    EXPECT_THROW({ [[maybe_unused]] auto _ = LazyRecord<Struct_3>(bytes.first(MAP_OFFSET + 12)).lookup<1>(8); },
+                 std::runtime_error);
+
+    // Value of key 2, the second sorted one, past the end
+    corrupt(VALUE_OFFSETS + sizeof(uint32_t), 1 << 20);
+    EXPECT_THROW({ [[maybe_unused]] auto _ = LazyRecord<Struct_3>(bytes).lookup<1>(2); }, std::runtime_error);
+    EXPECT_EQ(LazyRecord<Struct_3>(bytes).lookup<1>(8), "abcd");
+
+    // Map field past the end
+    corrupt(sizeof(uint32_t), 1 << 20);
+    EXPECT_THROW({ [[maybe_unused]] auto _ = LazyRecord<Struct_3>(bytes).count<1>(); }, std::runtime_error);
+}
+
+TEST(SerializationTest, TestOverlay)
+{
+    static_assert(OverlayLayout<Struct_1>::offsets == std::array<size_t, 3>{0, 4, 8});
+    static_assert(OverlayLayout<Struct_1>::size == 16);
+    static_assert(OverlayLayout<Integers>::offsets == std::array<size_t, 6>{0, 8, 16, 20, 24, 28});
+    static_assert(OverlayLayout<Integers>::size == 32);
+    static_assert(OverlayLayout<Integers>::alignment == 8);
+
+    std::vector<Integers> objects;
+    SerDes::OutputBuffer buffer;
+
+    for (int n = 0; n < 100; ++n)
+    {
+        objects.push_back({-n, 1ul << (n % 64), static_cast<int16_t>(-2 * n),
+                           static_cast<uint32_t>(n) * 1000, static_cast<char>('a' + n % 26), n / 4.0f});
+    }
+
+    std::ranges::fill(buffer.append(3), std::byte(0));
+
+    size_t offset = serializeOverlay(std::span<const Integers>(objects), buffer);
+
+    ASSERT_EQ(offset, OVERLAY_ALIGNMENT);
+    ASSERT_EQ(buffer.size(), offset + sizeof(OverlayHeader) + objects.size() * 32);
+
+    // Padding after i16 and after c
+    const auto *firstRecord = buffer.bytes().data() + offset + sizeof(OverlayHeader);
+
+    EXPECT_EQ(firstRecord[18], std::byte(0));
+    EXPECT_EQ(firstRecord[19], std::byte(0));
+    EXPECT_EQ(firstRecord[25], std::byte(0));
+    EXPECT_EQ(firstRecord[27], std::byte(0));
+
+    // In place over a mapped file
+    TemporaryFile file;
+
+    {
+        FileDescriptor fd(file.path(), O_WRONLY | O_TRUNC);
+        auto block = buffer.bytes().subspan(offset);
+
+        ASSERT_EQ(::write(fd.get(), block.data(), block.size()), static_cast<ssize_t>(block.size()));
+    }
+
+    MappedFile mappedFile(file.path());
+    OverlayArray<Integers> records(mappedFile.bytes());
+
+    ASSERT_EQ(records.size(), objects.size());
+
+    for (size_t n = 0; n < objects.size(); ++n)
+    {
+        ASSERT_EQ(records[n].get<0>(), objects[n].i64);
+        ASSERT_EQ(records[n].get<1>(), objects[n].u64);
+        ASSERT_EQ(records[n].get<2>(), objects[n].i16);
+        ASSERT_EQ(records[n].get<3>(), objects[n].u32);
+        ASSERT_EQ(records[n].get<4>(), objects[n].c);
+        ASSERT_EQ(records[n].get<5>(), objects[n].f);
+    }
+
+    Integers materialized;
+
+    records[42].materialize(materialized);
+    EXPECT_EQ(materialized.i64, -42);
+    EXPECT_EQ(materialized.f, 10.5f);
+
+    EXPECT_THROW(OverlayArray<Struct_1>(mappedFile.bytes()), std::runtime_error);
+    EXPECT_THROW(OverlayArray<Integers>(mappedFile.bytes().first(100)), std::runtime_error);
+    EXPECT_THROW(OverlayArray<Integers>(buffer.bytes().subspan(offset - 1)), std::runtime_error);
+}
+
+TEST(SerializationTest, TestSerializeParallel)
+{
+    Struct_3 record{-3, {}};
+    std::minstd_rand random(42);
+
+    // Keys clustered at both ends, so that some key ranges are empty
+    for (int n = 0; n < 100'000; ++n)
+    {
+        int key = n % 2 ? static_cast<int>(random() % 1000) : INT_MAX - static_cast<int>(random() % 100'000);
+
+        record.m.emplace(key, std::string(random() % 20, 'a' + n % 26));
+    }
+
+    auto expected = record.serialize();
+
+    for (size_t nbThreads : {1, 2, 3, 8})
+    {
+        SerDes::OutputBuffer buffer;
+
+        std::ranges::fill(buffer.append(7), std::byte(0));
+        ASSERT_EQ(serializeParallel(record, buffer, nbThreads), 7);
+        ASSERT_TRUE(std::ranges::equal(buffer.bytes().subspan(7),
+                                       std::span(expected.data.get(), expected.size)))
+            << "nbThreads=" << nbThreads;
+    }
+
+    // One outlier key must not put every other entry in the same range
+    Struct_3 outlierRecord{0, {{INT_MAX, "z"}}};
+
+    for (int key = 0; key <= 1'000'000; ++key)
+    {
+        outlierRecord.m.emplace(key, "");
+    }
+
+    auto boundaries = splitEntries(outlierRecord.m, 32);
+
+    ASSERT_EQ(boundaries.size(), 33);
+    EXPECT_EQ(boundaries.front(), outlierRecord.m.begin());
+    EXPECT_EQ(boundaries.back(), outlierRecord.m.end());
+
+    for (size_t n = 0; n + 1 < boundaries.size(); ++n)
+    {
+        auto rangeSize = static_cast<size_t>(std::distance(boundaries[n], boundaries[n + 1]));
+
+        EXPECT_GE(rangeSize, outlierRecord.m.size() / 32) << "range=" << n;
+        EXPECT_LE(rangeSize, outlierRecord.m.size() / 32 + 1) << "range=" << n;
+    }
+
+    auto outlierExpected = outlierRecord.serialize();
+    SerDes::OutputBuffer outlierBuffer;
+
+    serializeParallel(outlierRecord, outlierBuffer, 8);
+    EXPECT_TRUE(std::ranges::equal(outlierBuffer.bytes(),
+                                   std::span(outlierExpected.data.get(), outlierExpected.size)));
+
+    // Too small to be split
+    SerDes::OutputBuffer buffer;
+    Struct_3 smallRecord{1, {{1, "a"}, {2, "b"}}};
+    auto smallExpected = smallRecord.serialize();
+
+    serializeParallel(smallRecord, buffer, 4);
+    EXPECT_TRUE(std::ranges::equal(buffer.bytes(), std::span(smallExpected.data.get(), smallExpected.size)));
+}
+
+TEST(SerializationTest, TestAsyncRecordWriter)
+{
+    using Backend_t = AsyncRecordWriter::Backend;
+
+    constexpr int RECORDS_TOTAL = 5000;
+
+    for (Backend_t backend : {Backend_t::IoUring, Backend_t::ThreadPool})
+    {
+        TemporaryFile file;
+
+        {
+            // Small buffers to go through many submissions and waits for a free buffer
+            AsyncRecordWriter writer(file.path(), 1024, 3, backend);
+
+            if (backend == Backend_t::ThreadPool)
+            {
+                EXPECT_EQ(writer.backend(), Backend_t::ThreadPool);
+            }
+
+            for (int n = 0; n < RECORDS_TOTAL; ++n)
+            {
+                // Some records don't fit in a buffer
+                Struct_2 record(n, 'a' + n % 26, std::string(n % 97 == 0 ? 2000 : n % 300, 'x'));
+
+                if (n % 2)
+                {
+                    writer.write(record);
+                }
+                else
+                {
+                    writer.write(record.serialize());
+                }
+
+                if (n == RECORDS_TOTAL / 2)
+                {
+                    writer.flush();
+                }
+            }
+        }
+
+        RecordReader reader(file.path());
+
+        for (int n = 0; n < RECORDS_TOTAL; ++n)
+        {
+            auto data = reader.next();
+            Struct_2 record;
+
+            ASSERT_TRUE(data);
+            record.deserialize(*data);
+            ASSERT_EQ(record.n, n);
+            ASSERT_EQ(record.c, 'a' + n % 26);
+            ASSERT_EQ(record.s, std::string(n % 97 == 0 ? 2000 : n % 300, 'x'));
+        }
+
+        EXPECT_EQ(reader.next(), std::nullopt);
+    }
+}
+
+TEST(SerializationTest, TestAsyncRecordWriterWriteError)
+{
+    using Backend_t = AsyncRecordWriter::Backend;
+
+    EXPECT_THROW(AsyncRecordWriter("/dev/full", 1024, 0), std::invalid_argument);
+
+    for (Backend_t backend : {Backend_t::IoUring, Backend_t::ThreadPool})
+    {
+        Struct_2 record(1, 'a', std::string(100, 'x'));
+
+        {
+            // A single buffer, so the failed one is waited for on the next submission
+            AsyncRecordWriter writer("/dev/full", 1024, 1, backend);
+
+            EXPECT_THROW({
+                for (int n = 0; n < 100; ++n)
+                {
+                    writer.write(record);
+                }
+            }, std::system_error);
+            EXPECT_THROW(writer.write(record), std::system_error);
+            EXPECT_THROW(writer.flush(), std::system_error);
+            EXPECT_THROW(writer.close(), std::system_error);
+            EXPECT_NO_THROW(writer.close());
+        }
+
+        // Not closed, the destructor neither hangs nor writes the buffer again
+        {
+            AsyncRecordWriter writer("/dev/full", 1024, 2, backend);
+
+            writer.write(record);
+        }
+    }
+}
+
+namespace
+{
+    constexpr size_t BENCHMARK_OPS = 1'000'000;
+
+    template <typename Struct>
+    void benchmarkSchemaAgainstHandwritten(const char *name, const Struct& object)
+    {
+        const SerDes& serDes = object;
+        auto serialized = object.serialize();
+        Struct deserialized;
+        SerDes& deserializedSerDes = deserialized;
+        volatile size_t sink = 0;
+
+        double handwrittenSerializeNs = measureNsPerOp(BENCHMARK_OPS, [&]()
+        {
+            sink = sink + serDes.serialize().size;
+        });
+        double generatedSerializeNs = measureNsPerOp(BENCHMARK_OPS, [&]()
+        {
+            sink = sink + serializeWithSchema(object).size;
+        });
+        double handwrittenDeserializeNs = measureNsPerOp(BENCHMARK_OPS, [&]()
+        {
+            deserialized = Struct();
+            deserializedSerDes.deserialize(serialized);
+        });
+        double generatedDeserializeNs = measureNsPerOp(BENCHMARK_OPS, [&]()
+        {
+            deserialized = Struct();
+            deserializeWithSchema(deserialized, serialized);
+        });
+
+        std::cout << name
+                  << " serialize handwritten=" << handwrittenSerializeNs
+                  << "ns generated=" << generatedSerializeNs
+                  << "ns deserialize handwritten=" << handwrittenDeserializeNs
+                  << "ns generated=" << generatedDeserializeNs << "ns" << std::endl;
+    }
+}
+
+// Benchmarks are disabled by default, run them with --gtest_also_run_disabled_tests
+TEST(SerializationBenchmark, DISABLED_SchemaAgainstHandwritten)
+{
+    std::map<int, std::string> map;
+
+    for (int n = 0; n < 32; ++n)
+    {
+        map.emplace(n * 7, "value number " + std::to_string(n));
+    }
+
+    benchmarkSchemaAgainstHandwritten("Struct_1", Struct_1{42, 84.5, 245.2});
+    benchmarkSchemaAgainstHandwritten("Struct_2", Struct_2{42, 'a', "Hello World, a medium sized string !"});
+    benchmarkSchemaAgainstHandwritten("Struct_3", Struct_3{3, map});
+}
+
+// Reading one string field and one map value, through a view or a full deserialization
+TEST(SerializationBenchmark, DISABLED_ViewsAgainstDeserialize)
+{
+    std::map<int, std::string> map;
+
+    for (int n = 0; n < 32; ++n)
+    {
+        map.emplace(n * 7, "value number " + std::to_string(n));
+    }
+
+    auto serialized_2 = std::make_shared<const SerDes::SerializedData>(
+        Struct_2{42, 'a', "Hello World, a medium sized string !"}.serialize());
+    auto serialized_3 = std::make_shared<const SerDes::SerializedData>(
+        Struct_3{3, map}.serialize());
+    volatile size_t sink = 0;
+
+    double deserialize_2Ns = measureNsPerOp(BENCHMARK_OPS, [&]()
+    {
+        Struct_2 deserialized;
+
+        deserialized.deserialize(*serialized_2);
+        sink = sink + deserialized.s.size();
+    });
+    double view_2Ns = measureNsPerOp(BENCHMARK_OPS, [&]()
+    {
+        sink = sink + Struct_2View(serialized_2).s().size();
+    });
+    double deserialize_3Ns = measureNsPerOp(BENCHMARK_OPS, [&]()
+    {
+        Struct_3 deserialized;
+
+        deserialized.deserialize(*serialized_3);
+        sink = sink + deserialized.m.at(21 * 7).size();
+    });
+    double view_3Ns = measureNsPerOp(BENCHMARK_OPS, [&]()
+    {
+        sink = sink + Struct_3View(serialized_3).m().lookup(21 * 7)->size();
+    });
+
+    std::cout << "Struct_2 deserialize=" << deserialize_2Ns << "ns view=" << view_2Ns
+              << "ns Struct_3 deserialize=" << deserialize_3Ns << "ns view=" << view_3Ns
+              << "ns" << std::endl;
+}
+
+// Serializing batches of records, one allocation per record or all appended
+// to a buffer reused from one batch to the next
+TEST(SerializationBenchmark, DISABLED_SerializeIntoBuffer)
+{
+    constexpr size_t BATCH_SIZE = 1024;
+    Struct_2 record{42, 'a', "Hello World, a medium sized string !"};
+    std::vector<SerDes::SerializedData> batch(BATCH_SIZE);
+    SerDes::OutputBuffer buffer;
+    volatile size_t sink = 0;
+
+    double allocatingNs = measureNsPerOp(BENCHMARK_OPS / BATCH_SIZE, [&]()
+    {
+        for (auto& data : batch)
+        {
+            data = record.serialize();
+        }
+
+        sink = sink + batch.back().size;
+    }) / BATCH_SIZE;
+    double bufferNs = measureNsPerOp(BENCHMARK_OPS / BATCH_SIZE, [&]()
+    {
+        buffer.clear();
+
+        for (size_t n = 0; n < BATCH_SIZE; ++n)
+        {
+            record.serialize(buffer);
+        }
+
+        sink = sink + buffer.size();
+    }) / BATCH_SIZE;
+
+    std::cout << "serialize allocating=" << allocatingNs
+              << "ns into buffer=" << bufferNs << "ns" << std::endl;
+}
+
+// Struct_3 holding a map of short strings, fixed width against compact encoding
+TEST(SerializationBenchmark, DISABLED_CompactEncoding)
+{
+    std::map<int, std::string> map;
+
+    for (int n = 0; n < 64; ++n)
+    {
+        map.emplace(n * 3, "v" + std::to_string(n));
+    }
+
+    Struct_3 record{3, map};
+    auto benchmark = [&record]<Encoding E>(const char *name)
+    {
+        auto data = serializeWithSchema<E>(record);
+        Struct_3 deserialized;
+        double decodeNs = measureNsPerOp(BENCHMARK_OPS / 10, [&]()
+        {
+            deserializeWithSchema<E>(deserialized, data);
+        });
+
+        std::cout << name << " bytes/record=" << data.size
+                  << " decode=" << 1e3 / decodeNs << "Mrecords/s "
+                  << data.size / decodeNs << "GB/s" << std::endl;
+    };
+
+    benchmark.template operator()<Encoding::FixedWidth>("fixed width");
+    benchmark.template operator()<Encoding::Compact>("compact");
+}
+
+// Streaming records to a file, one write() per frame against batched writev()
+TEST(SerializationBenchmark, DISABLED_RecordWriter)
+{
+    Struct_2 record{42, 'a', "Hello World, a medium sized string !"};
+    TemporaryFile file;
+
+    double writeNs = measureNsPerOp(1, [&]()
+    {
+        FileDescriptor fd(file.path(), O_WRONLY | O_TRUNC);
+
+        for (size_t n = 0; n < BENCHMARK_OPS; ++n)
+        {
+            auto data = record.serialize();
+            FrameHeader header{data.size, crc32c({data.data.get(), data.size})};
+
+            if (::write(fd.get(), &header, sizeof(header)) == -1 ||
+                ::write(fd.get(), data.data.get(), data.size) == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), "write");
+            }
+        }
+    }) / BENCHMARK_OPS;
+    double writerNs = measureNsPerOp(1, [&]()
+    {
+        RecordWriter writer(file.path());
+
+        for (size_t n = 0; n < BENCHMARK_OPS; ++n)
+        {
+            writer.write(record);
+        }
+    }) / BENCHMARK_OPS;
+    double readerNs = measureNsPerOp(1, [&]()
+    {
+        RecordReader reader(file.path());
+
+        while (reader.next())
+        {
+        }
+    }) / BENCHMARK_OPS;
+
+    std::cout << "write() per frame=" << writeNs << "ns RecordWriter=" << writerNs
+              << "ns RecordReader=" << readerNs << "ns" << std::endl;
+}
+
+// Opening only reads the footer : the time doesn't depend on the archive size
+TEST(SerializationBenchmark, DISABLED_Archive)
+{
+    constexpr size_t OPEN_OPS = 10'000;
+    Struct_2 record{42, 'a', "Hello World, a medium sized string !"};
+    TemporaryFile smallFile;
+    TemporaryFile largeFile;
+
+    {
+        ArchiveWriter smallWriter(smallFile.path());
+        ArchiveWriter largeWriter(largeFile.path());
+
+        smallWriter.append(record);
+
+        for (size_t n = 0; n < BENCHMARK_OPS; ++n)
+        {
+            largeWriter.append(record);
+        }
+    }
+
+    volatile size_t sink = 0;
+    double smallOpenNs = measureNsPerOp(OPEN_OPS, [&]()
+    {
+        sink = sink + ArchiveReader(smallFile.path()).size();
+    });
+    double largeOpenNs = measureNsPerOp(OPEN_OPS, [&]()
+    {
+        sink = sink + ArchiveReader(largeFile.path()).size();
+    });
+
+    ArchiveReader reader(largeFile.path());
+    std::minstd_rand random(42);
+    Struct_2 readRecord;
+
+    double randomReadNs = measureNsPerOp(BENCHMARK_OPS, [&]()
+    {
+        reader.read(random() % reader.size(), readRecord);
+    });
+
+    std::cout << "open 1 record=" << smallOpenNs << "ns open " << BENCHMARK_OPS
+              << " records=" << largeOpenNs << "ns random read=" << randomReadNs
+              << "ns" << std::endl;
+}
+
+// Batch of Struct_1 serialized object by object through SerDes against the
+// columnar format, with a memcpy of the same amount of bytes as upper bound
+TEST(SerializationBenchmark, DISABLED_Columnar)
+{
+    constexpr size_t BATCH_SIZE = 100'000;
+    constexpr size_t BATCHES_TOTAL = 100;
+    std::vector<Struct_1> objects;
+    std::vector<Struct_1> deserialized;
+    SerDes::OutputBuffer buffer;
+
+    for (size_t n = 0; n < BATCH_SIZE; ++n)
+    {
+        objects.emplace_back(static_cast<int>(n), 0.5f * n, 0.25 * n);
+    }
+
+    double perObjectSerializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        buffer.clear();
+
+        for (const SerDes& object : objects)
+        {
+            object.serialize(buffer);
+        }
+    }) / BATCH_SIZE;
+    double perObjectDeserializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        deserialized.resize(BATCH_SIZE);
+
+        size_t offset = 0;
+
+        for (SerDes& object : deserialized)
+        {
+            object.deserializeFrom(buffer.bytes().subspan(offset, object.serializedSize()));
+            offset += object.serializedSize();
+        }
+    }) / BATCH_SIZE;
+    double columnarSerializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        buffer.clear();
+        serializeColumnar(std::span<const Struct_1>(objects), buffer);
+    }) / BATCH_SIZE;
+    double columnarDeserializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        deserializeColumnar(buffer.bytes(), deserialized);
+    }) / BATCH_SIZE;
+
+    std::vector<std::byte> copy(buffer.size());
+    double memcpyNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        std::memcpy(copy.data(), buffer.bytes().data(), copy.size());
+    }) / BATCH_SIZE;
+    auto megabytesPerSecond = [bytesPerObject = double(buffer.size()) / BATCH_SIZE](double ns)
+    {
+        return bytesPerObject * 1e3 / ns;
+    };
+
+    std::cout << "serialize per object=" << megabytesPerSecond(perObjectSerializeNs)
+              << "MB/s columnar=" << megabytesPerSecond(columnarSerializeNs)
+              << "MB/s deserialize per object=" << megabytesPerSecond(perObjectDeserializeNs)
+              << "MB/s columnar=" << megabytesPerSecond(columnarDeserializeNs)
+              << "MB/s memcpy=" << megabytesPerSecond(memcpyNs) << "MB/s" << std::endl;
+}
+
+// Mixed objects serialized through unique_ptr<SerDes> and virtual calls
+// against the same objects stored inline in a SerDesBatch
+TEST(SerializationBenchmark, DISABLED_SerDesBatch)
+{
+    constexpr size_t BATCH_SIZE = 10'000;
+    constexpr size_t BATCHES_TOTAL = 100;
+    std::vector<std::unique_ptr<SerDes>> objects;
+    SerDesBatch<Struct_1, Struct_2, Struct_3> batch;
+    SerDes::OutputBuffer buffer;
+
+    for (size_t n = 0; n < BATCH_SIZE; ++n)
+    {
+        int value = static_cast<int>(n);
+
+        switch (n % 3)
+        {
+        case 0 :
+            objects.emplace_back(std::make_unique<Struct_1>(value, 0.5f * value, 0.25 * value));
+            batch.emplace_back<Struct_1>(value, 0.5f * value, 0.25 * value);
+            break;
+        case 1 :
+            objects.emplace_back(std::make_unique<Struct_2>(value, 'a', "Hello World"));
+            batch.emplace_back<Struct_2>(value, 'a', "Hello World");
+            break;
+        default :
+            objects.emplace_back(std::make_unique<Struct_3>(1, std::map<int, std::string>{{value, "abc"}}));
+            batch.emplace_back<Struct_3>(1, std::map<int, std::string>{{value, "abc"}});
+        }
+    }
+
+    std::vector<size_t> offsets;
+    double virtualSerializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        buffer.clear();
+        offsets = serializeAll(objects, buffer);
+    }) / BATCH_SIZE;
+    double virtualDeserializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        std::vector<std::unique_ptr<SerDes>> deserialized;
+
+        offsets.push_back(buffer.size());
+
+        for (size_t n = 0; n < BATCH_SIZE; ++n)
+        {
+            switch (n % 3)
+            {
+            case 0 : deserialized.emplace_back(std::make_unique<Struct_1>()); break;
+            case 1 : deserialized.emplace_back(std::make_unique<Struct_2>()); break;
+            default : deserialized.emplace_back(std::make_unique<Struct_3>());
+            }
+
+            deserialized.back()->deserializeFrom(
+                buffer.bytes().subspan(offsets[n], offsets[n + 1] - offsets[n]));
+        }
+
+        offsets.pop_back();
+    }) / BATCH_SIZE;
+    double batchSerializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        buffer.clear();
+        batch.serialize(buffer);
+    }) / BATCH_SIZE;
+    double batchDeserializeNs = measureNsPerOp(BATCHES_TOTAL, [&]()
+    {
+        SerDesBatch<Struct_1, Struct_2, Struct_3> deserialized;
+
+        deserialized.deserializeFrom(buffer.bytes());
+    }) / BATCH_SIZE;
+
+    std::cout << "serialize virtual=" << virtualSerializeNs << "ns batch=" << batchSerializeNs
+              << "ns deserialize virtual=" << virtualDeserializeNs
+              << "ns batch=" << batchDeserializeNs << "ns" << std::endl;
+}
+
+// Compression ratio and speed on repetitive Struct_3 records, memcpy as upper bound
+TEST(SerializationBenchmark, DISABLED_BlockCompression)
+{
+    constexpr size_t BLOCK_BYTES = 1 << 16;
+    constexpr size_t ROUNDS_TOTAL = 20;
+    auto records = makeStruct_3Records(10'000);
+    auto bytes = records.bytes();
+    std::vector<SerDes::SerializedData> blocks;
+    size_t compressedSize = 0;
+
+    double compressNs = measureNsPerOp(ROUNDS_TOTAL, [&]()
+    {
+        blocks.clear();
+        compressedSize = 0;
+
+        for (size_t offset = 0; offset < bytes.size(); offset += BLOCK_BYTES)
+        {
+            blocks.emplace_back(compressBlock(bytes.subspan(offset, std::min(BLOCK_BYTES, bytes.size() - offset))));
+            compressedSize += blocks.back().size;
+        }
+    });
+    double decompressNs = measureNsPerOp(ROUNDS_TOTAL, [&]()
+    {
+        for (const auto& block : blocks)
+        {
+            [[maybe_unused]] auto decompressed = decompressBlock({block.data.get(), block.size});
+        }
+    });
+
+    std::vector<std::byte> copy(bytes.size());
+    double memcpyNs = measureNsPerOp(ROUNDS_TOTAL, [&]()
+    {
+        std::memcpy(copy.data(), bytes.data(), bytes.size());
+    });
+    auto megabytesPerSecond = [&bytes](double ns) { return bytes.size() * 1e3 / ns; };
+
+    std::cout << "size=" << bytes.size() << " ratio=" << double(bytes.size()) / compressedSize
+              << " compress=" << megabytesPerSecond(compressNs)
+              << "MB/s decompress=" << megabytesPerSecond(decompressNs)
+              << "MB/s memcpy=" << megabytesPerSecond(memcpyNs) << "MB/s" << std::endl;
+}
+
+// CRC32C throughput and its cost relative to deserializing the same records
+TEST(SerializationBenchmark, DISABLED_Crc32c)
+{
+    constexpr size_t RECORDS_TOTAL = 10'000;
+    std::vector<SerDes::SerializedData> records;
+    size_t totalBytes = 0;
+
+    for (size_t n = 0; n < RECORDS_TOTAL; ++n)
+    {
+        Struct_3 record{static_cast<short>(n), {}};
+
+        for (int key = 0; key < 30; ++key)
+        {
+            record.m.emplace(key, "value of the entry");
+        }
+
+        records.emplace_back(record.serialize());
+        totalBytes += records.back().size;
+    }
+
+    volatile uint32_t sink = 0;
+    auto measureNsPerRecord = [&records](auto&& func)
+    {
+        return measureNsPerOp(10, [&]()
+        {
+            for (const auto& record : records)
+            {
+                func(record);
+            }
+        }) / RECORDS_TOTAL;
+    };
+    double deserializeNs = measureNsPerRecord([](const SerDes::SerializedData& data)
+    {
+        Struct_3 record;
+
+        record.deserialize(data);
+    });
+    double crc32cNs = measureNsPerRecord([&sink](const SerDes::SerializedData& data)
+    {
+        sink = sink + crc32c({data.data.get(), data.size});
+    });
+    double softwareNs = measureNsPerRecord([&sink](const SerDes::SerializedData& data)
+    {
+        sink = sink + crc::software({data.data.get(), data.size});
+    });
+
+    std::vector<std::byte> block(1 << 24);
+    double blockNs = measureNsPerOp(10, [&]()
+    {
+        sink = sink + crc32c(block);
+    });
+
+    std::cout << "record=" << totalBytes / RECORDS_TOTAL << "B deserialize=" << deserializeNs
+              << "ns crc32c=" << crc32cNs << "ns (" << 100 * crc32cNs / deserializeNs
+              << "%) table=" << softwareNs << "ns crc32c 16MB block="
+              << block.size() / blockNs << "GB/s" << std::endl;
+}
+
+// Reading the scalar and one map entry of a record with a big map
+TEST(SerializationBenchmark, DISABLED_LazyRecord)
+{
+    constexpr size_t LOOKUP_OPS = 100'000;
+    Struct_3 record{42, {}};
+    SerDes::OutputBuffer buffer;
+
+    for (int key = 0; key < 10'000; ++key)
+    {
+        record.m.emplace(key * 3, "value number " + std::to_string(key));
+    }
+
+    auto serialized = record.serialize();
+    auto shared = std::make_shared<const SerDes::SerializedData>(record.serialize());
+
+    serializeIndexed(record, buffer);
+
+    LazyRecord<Struct_3> lazyRecord(buffer.bytes());
+    Struct_3View view(shared);
+    std::minstd_rand random(42);
+    volatile size_t sink = 0;
+
+    double deserializeNs = measureNsPerOp(LOOKUP_OPS / 100, [&]()
+    {
+        Struct_3 deserialized;
+
+        deserialized.deserialize(serialized);
+        sink = sink + deserialized.s + deserialized.m.at(3 * (random() % 10'000)).size();
+    });
+    double viewNs = measureNsPerOp(LOOKUP_OPS / 100, [&]()
+    {
+        sink = sink + view.s() + view.m().lookup(3 * (random() % 10'000))->size();
+    });
+    double lazyNs = measureNsPerOp(LOOKUP_OPS, [&]()
+    {
+        sink = sink + lazyRecord.get<0>() + lazyRecord.lookup<1>(3 * (random() % 10'000))->size();
+    });
+
+    std::cout << "record=" << serialized.size << "B deserialize=" << deserializeNs
+              << "ns view=" << viewNs << "ns lazy=" << lazyNs << "ns (indexed layout="
+              << buffer.size() << "B)" << std::endl;
+}
+
+// Reading every field of Struct_1 records deserialized one by one against in place
+TEST(SerializationBenchmark, DISABLED_Overlay)
+{
+    constexpr size_t RECORDS_TOTAL = 100'000;
+    constexpr size_t ROUNDS_TOTAL = 100;
+    std::vector<Struct_1> objects;
+    SerDes::OutputBuffer packed;
+    SerDes::OutputBuffer overlay;
+
+    for (size_t n = 0; n < RECORDS_TOTAL; ++n)
+    {
+        objects.emplace_back(static_cast<int>(n), 0.5f * n, 0.25 * n);
+        objects.back().serialize(packed);
+    }
+
+    serializeOverlay(std::span<const Struct_1>(objects), overlay);
+
+    OverlayArray<Struct_1> records(overlay.bytes());
+    const size_t packedSize = objects[0].serializedSize();
+    volatile double sink = 0;
+
+    double deserializeNs = measureNsPerOp(ROUNDS_TOTAL, [&]()
+    {
+        Struct_1 record;
+        double sum = 0;
+
+        for (size_t n = 0; n < RECORDS_TOTAL; ++n)
+        {
+            record.deserializeFrom(packed.bytes().subspan(n * packedSize, packedSize));
+            sum += record.n + record.f + record.d;
+        }
+
+        sink = sum;
+    }) / RECORDS_TOTAL;
+    double overlayNs = measureNsPerOp(ROUNDS_TOTAL, [&]()
+    {
+        double sum = 0;
+
+        for (size_t n = 0; n < records.size(); ++n)
+        {
+            sum += records[n].get<0>() + records[n].get<1>() + records[n].get<2>();
+        }
+
+        sink = sum;
+    }) / RECORDS_TOTAL;
+
+    std::cout << "deserialize=" << deserializeNs << "ns overlay=" << overlayNs << "ns" << std::endl;
+}
+
+// Struct_3 with millions of entries, serialized sequentially against in parallel
+TEST(SerializationBenchmark, DISABLED_SerializeParallel)
+{
+    Struct_3 record{1, {}};
+    SerDes::OutputBuffer buffer;
+
+    for (int key = 0; key < 4'000'000; ++key)
+    {
+        record.m.emplace(key * 7, "value number " + std::to_string(key));
+    }
+
+    auto measureMs = [&](auto&& serialize)
+    {
+        return measureNsPerOp(5, [&]()
+        {
+            buffer.clear();
+            serialize();
+        }) / 1e6;
+    };
+
+    std::cout << "size=" << record.serializedSize() << "B sequential="
+              << measureMs([&]() { record.serialize(buffer); }) << "ms";
+
+    size_t maxThreads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (size_t nbThreads = 2; nbThreads <= maxThreads; nbThreads *= 2)
+    {
+        std::cout << " threads=" << nbThreads << ":"
+                  << measureMs([&]() { serializeParallel(record, buffer, nbThreads); }) << "ms";
+    }
+
+    std::cout << std::endl;
+}
+
+// Streaming records through synchronous pwrite() of full batches against the
+// asynchronous writer with either backend. Writes only overlap serialization
+// when a core is free to run them
+TEST(SerializationBenchmark, DISABLED_AsyncRecordWriter)
+{
+    using Backend_t = AsyncRecordWriter::Backend;
+
+    constexpr size_t BATCH_BYTES = 1 << 20;
+    Struct_2 record{42, 'a', std::string(200, 'x')};
+    const size_t frameSize = sizeof(FrameHeader) + record.serializedSize();
+    TemporaryFile syncFile;
+
+    auto megabytesPerSecond = [frameSize](double nsPerRecord) { return frameSize * 1e3 / nsPerRecord; };
+    double syncNs = measureNsPerOp(1, [&]()
+    {
+        FileDescriptor fd(syncFile.path(), O_WRONLY | O_TRUNC);
+        SerDes::OutputBuffer batch;
+        uint64_t fileSize = 0;
+
+        for (size_t n = 0; n < BENCHMARK_OPS; ++n)
+        {
+            auto frame = batch.append(frameSize);
+            auto payload = frame.subspan(sizeof(FrameHeader));
+
+            record.serializeInto(payload);
+
+            FrameHeader header{payload.size(), frameChecksum(payload)};
+
+            std::memcpy(frame.data(), &header, sizeof(header));
+
+            if (batch.size() >= BATCH_BYTES || n + 1 == BENCHMARK_OPS)
+            {
+                pwriteAll(fd.get(), batch.bytes(), fileSize);
+                fileSize += batch.size();
+                batch.clear();
+            }
+        }
+    }) / BENCHMARK_OPS;
+
+    std::cout << "sync pwrite()=" << megabytesPerSecond(syncNs) << "MB/s";
+
+    for (Backend_t backend : {Backend_t::IoUring, Backend_t::ThreadPool})
+    {
+        // Each run on its own new file, not truncating the previous one while measured
+        TemporaryFile file;
+        bool isIoUring = false;
+        double asyncNs = measureNsPerOp(1, [&]()
+        {
+            AsyncRecordWriter writer(file.path(), BATCH_BYTES, 4, backend);
+
+            isIoUring = writer.backend() == Backend_t::IoUring;
+
+            for (size_t n = 0; n < BENCHMARK_OPS; ++n)
+            {
+                writer.write(record);
+            }
+        }) / BENCHMARK_OPS;
+
+        std::cout << (isIoUring ? " io_uring=" : " thread pool=") << megabytesPerSecond(asyncNs) << "MB/s";
+    }
+
+    std::cout << std::endl;
+}
+
+namespace
+{
+    struct ThroughputResult
+    {
+        std::string structName;
+        size_t payloadBytes;
+        std::string operation;
+        double nsPerOp;
+        double allocationsPerOp;
+
+        [[nodiscard]]
+        inline double megabytesPerSecond() const noexcept { return payloadBytes * 1e3 / nsPerOp; }
+
+        [[nodiscard]]
+        inline double recordsPerSecond() const noexcept { return 1e9 / nsPerOp; }
+    };
+
+    // Enough operations to move about 256MB, bounded for tiny and huge payloads
+    [[nodiscard]]
+    size_t throughputOps(size_t payloadBytes)
+    {
+        return std::clamp<size_t>((256 << 20) / payloadBytes, 100, BENCHMARK_OPS);
+    }
+
+    // Time and allocations of one call of func, averaged on nbOps calls.
+    // Operator new is counted per thread so the measured thread is alone
+    template <typename Func>
+    [[nodiscard]]
+    std::pair<double, double> measureOp(size_t nbOps, Func&& func)
+    {
+        size_t allocationsBefore = globalAllocationsCount;
+        double nsPerOp = measureNsPerOp(nbOps, func);
+
+        return {nsPerOp, static_cast<double>(globalAllocationsCount - allocationsBefore) / nbOps};
+    }
+
+    /* Serialization to a new SerializedData and into a reused OutputBuffer,
+       deserialization into a new object, and a memcpy() of the same payload
+       as the upper bound of what any of them can reach */
+    template <typename Struct>
+    void benchmarkThroughput(const std::string& structName, const Struct& object,
+                             std::vector<ThroughputResult>& results)
+    {
+        const SerDes& serDes = object;
+        const auto serialized = object.serialize();
+        const size_t payloadBytes = serialized.size;
+        const size_t nbOps = throughputOps(payloadBytes);
+        std::vector<SerDes::SerializedData::Memory> copy(payloadBytes);
+        SerDes::OutputBuffer buffer;
+        volatile size_t sink = 0;
+
+        auto addResult = [&](const char *operation, std::pair<double, double> measure)
+        {
+            results.push_back({structName, payloadBytes, operation, measure.first, measure.second});
+        };
+
+        // Warms up the buffer so its growth isn't counted
+        serDes.serialize(buffer);
+
+        addResult("serialize", measureOp(nbOps, [&]()
+        {
+            sink = sink + serDes.serialize().size;
+        }));
+        addResult("serialize_into_buffer", measureOp(nbOps, [&]()
+        {
+            buffer.clear();
+            serDes.serialize(buffer);
+            sink = sink + buffer.size();
+        }));
+        addResult("deserialize", measureOp(nbOps, [&]()
+        {
+            Struct deserialized;
+            // Unknown to the compiler, which can't drop the deserialization
+            SerDes *volatile deserializedSerDes = &deserialized;
+
+            deserializedSerDes->deserialize(serialized);
+        }));
+        addResult("memcpy", measureOp(nbOps, [&]()
+        {
+            std::memcpy(copy.data(), serialized.data.get(), payloadBytes);
+            sink = sink + std::to_integer<size_t>(copy[payloadBytes / 2]);
+        }));
+    }
+
+    void writeThroughputCsv(std::ostream& output, const std::vector<ThroughputResult>& results)
+    {
+        output << "struct,payload_bytes,operation,ns_per_op,mb_per_s,records_per_s,allocations_per_op\n";
+
+        for (const auto& result : results)
+        {
+            output << result.structName << ',' << result.payloadBytes << ','
+                   << result.operation << ',' << result.nsPerOp << ','
+                   << result.megabytesPerSecond() << ',' << result.recordsPerSecond() << ','
+                   << result.allocationsPerOp << '\n';
+        }
+    }
+
+    void writeThroughputJson(std::ostream& output, const std::vector<ThroughputResult>& results)
+    {
+        output << "[\n";
+
+        for (size_t n = 0; n < results.size(); ++n)
+        {
+            const auto& result = results[n];
+
+            output << "  {\"struct\": \"" << result.structName
+                   << "\", \"payload_bytes\": " << result.payloadBytes
+                   << ", \"operation\": \"" << result.operation
+                   << "\", \"ns_per_op\": " << result.nsPerOp
+                   << ", \"mb_per_s\": " << result.megabytesPerSecond()
+                   << ", \"records_per_s\": " << result.recordsPerSecond()
+                   << ", \"allocations_per_op\": " << result.allocationsPerOp
+                   << (n + 1 < results.size() ? "},\n" : "}\n");
+        }
+
+        output << "]\n";
+    }
+}
+
+// Throughput of each struct across payload sizes, printed as CSV. Set
+// SERIALIZATION_BENCHMARK_OUTPUT to a .json or .csv path to write it there instead
+TEST(SerializationBenchmark, DISABLED_Throughput)
+{
+    std::vector<ThroughputResult> results;
+
+    benchmarkThroughput("Struct_1", Struct_1{42, 84.5, 245.2}, results);
+
+    for (size_t length : {16, 256, 4096, 65536})
+    {
+        benchmarkThroughput("Struct_2", Struct_2{42, 'a', std::string(length, 'x')}, results);
+    }
+
+    for (int entries : {1, 16, 256, 4096})
+    {
+        std::map<int, std::string> map;
+
+        for (int n = 0; n < entries; ++n)
+        {
+            map.emplace(n * 7, "value number " + std::to_string(n));
+        }
+
+        benchmarkThroughput("Struct_3", Struct_3{3, map}, results);
+    }
+
+    const char *outputPath = std::getenv("SERIALIZATION_BENCHMARK_OUTPUT");
+
+    if (outputPath == nullptr)
+    {
+        writeThroughputCsv(std::cout, results);
+        return;
+    }
+
+    std::filesystem::path path(outputPath);
+    std::ofstream output(path);
+
+    ASSERT_TRUE(output) << "cannot open " << path;
+
+    if (path.extension() == ".json")
+    {
+        writeThroughputJson(output, results);
+    }
+    else
+    {
+        writeThroughputCsv(output, results);
+    }
+
+    std::cout << results.size() << " results written to " << path << std::endl;
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,402 @@
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <gtest/gtest.h>
+
+namespace
+{
+    // Fixed, std::hardware_destructive_interference_size isn't ABI stable
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /* Chase-Lev lock-free work-stealing deque : its owner thread pushes and
+       pops at the bottom (LIFO, cache friendly) while thief threads steal
+       from the top (FIFO, oldest and usually biggest tasks). Owner and
+       thieves only compete with a CAS on top when one element is left.
+       The ring buffer doubles when full : the old buffers are retired and
+       kept alive until destruction since a thief may still be reading them.
+       Elements are read and written atomically so they must be trivially
+       copyable (e.g. task pointers or indices) */
+    template <typename T>
+    class WorkStealingDeque
+    {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "elements are copied atomically");
+
+    public :
+        explicit WorkStealingDeque(size_t capacity = 64)
+        {
+            _buffers.emplace_back(std::make_unique<Buffer>(std::bit_ceil(capacity)));
+            _buffer.store(_buffers.back().get(), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // Approximated while other threads are using the deque
+        [[nodiscard]]
+        inline bool empty() const noexcept { return size() == 0; }
+
+        [[nodiscard]]
+        inline size_t size() const noexcept
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed);
+            int64_t top = _top.load(std::memory_order_relaxed);
+
+            return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+        }
+
+        [[nodiscard]]
+        inline size_t capacity() const noexcept
+        {
+            return _buffer.load(std::memory_order_relaxed)->capacity();
+        }
+
+        // Owner thread only
+        void push(T value)
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed);
+            int64_t top = _top.load(std::memory_order_acquire);
+            Buffer *buffer = _buffer.load(std::memory_order_relaxed);
+
+            if (bottom - top >= static_cast<int64_t>(buffer->capacity()))
+            {
+                buffer = grow(buffer, bottom, top);
+            }
+
+            buffer->store(bottom, value);
+            std::atomic_thread_fence(std::memory_order_release);
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        // Owner thread only, takes the last pushed element
+        [[nodiscard]]
+        std::optional<T> pop()
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+            Buffer *buffer = _buffer.load(std::memory_order_relaxed);
+
+            // Reserves the bottom element before looking at what thieves did
+            _bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            int64_t top = _top.load(std::memory_order_relaxed);
+
+            if (top > bottom)
+            {
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+
+                return std::nullopt;
+            }
+
+            std::optional<T> value = buffer->load(bottom);
+
+            if (top == bottom)
+            {
+                // Last element : race against thieves for it
+                if (!_top.compare_exchange_strong(top, top + 1,
+                                                  std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed))
+                {
+                    value = std::nullopt;
+                }
+
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+
+            return value;
+        }
+
+        // Any thread, takes the oldest element. Returns std::nullopt when
+        // empty or when losing a race against another thief or the owner
+        [[nodiscard]]
+        std::optional<T> steal()
+        {
+            int64_t top = _top.load(std::memory_order_acquire);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+            if (top >= bottom)
+            {
+                return std::nullopt;
+            }
+
+            T value = _buffer.load(std::memory_order_acquire)->load(top);
+
+            if (!_top.compare_exchange_strong(top, top + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed))
+            {
+                return std::nullopt;
+            }
+
+            return value;
+        }
+
+    private :
+        class Buffer
+        {
+        public :
+            explicit Buffer(size_t capacity)
+                : _mask(capacity - 1),
+                  _elements(std::make_unique<std::atomic<T>[]>(capacity))
+            { }
+
+            [[nodiscard]]
+            inline size_t capacity() const noexcept { return _mask + 1; }
+
+            [[nodiscard]]
+            inline T load(int64_t index) const noexcept
+            {
+                return _elements[index & _mask].load(std::memory_order_relaxed);
+            }
+
+            inline void store(int64_t index, T value) noexcept
+            {
+                _elements[index & _mask].store(value, std::memory_order_relaxed);
+            }
+
+        private :
+            size_t _mask;
+            std::unique_ptr<std::atomic<T>[]> _elements;
+        };
+
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _top = 0;
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _bottom = 0;
+        std::atomic<Buffer *> _buffer;
+        // Owner thread only, current buffer and the retired ones
+        std::vector<std::unique_ptr<Buffer>> _buffers;
+
+        Buffer *grow(Buffer *buffer, int64_t bottom, int64_t top)
+        {
+            auto newBuffer = std::make_unique<Buffer>(buffer->capacity() * 2);
+
+            for (int64_t index = top; index < bottom; ++index)
+            {
+                newBuffer->store(index, buffer->load(index));
+            }
+
+            _buffers.emplace_back(std::move(newBuffer));
+            _buffer.store(_buffers.back().get(), std::memory_order_release);
+
+            return _buffers.back().get();
+        }
+    };
+}
+
+TEST(WorkStealingDequeTest, Test_1)
+{
+    WorkStealingDeque<int> deque(2);
+
+    ASSERT_TRUE(deque.empty());
+    ASSERT_EQ(deque.size(), 0);
+    EXPECT_EQ(deque.pop(), std::nullopt);
+    EXPECT_EQ(deque.steal(), std::nullopt);
+
+    deque.push(1);
+    deque.push(2);
+    deque.push(3);
+    deque.push(4);
+
+    ASSERT_EQ(deque.size(), 4);
+    EXPECT_EQ(deque.pop(), 4);
+    EXPECT_EQ(deque.steal(), 1);
+    EXPECT_EQ(deque.pop(), 3);
+    EXPECT_EQ(deque.pop(), 2);
+    ASSERT_TRUE(deque.empty());
+    EXPECT_EQ(deque.pop(), std::nullopt);
+    EXPECT_EQ(deque.steal(), std::nullopt);
+
+    deque.push(5);
+
+    EXPECT_EQ(deque.steal(), 5);
+    EXPECT_EQ(deque.pop(), std::nullopt);
+}
+
+// Growing keeps elements and their order, including after wrapping around
+TEST(WorkStealingDequeTest, Test_2)
+{
+    WorkStealingDeque<int> deque(4);
+
+    deque.push(0);
+    deque.push(1);
+    deque.push(2);
+    EXPECT_EQ(deque.steal(), 0);
+    EXPECT_EQ(deque.steal(), 1);
+
+    for (int n = 3; n < 100; ++n)
+    {
+        deque.push(n);
+    }
+
+    ASSERT_EQ(deque.size(), 98);
+    EXPECT_EQ(deque.capacity(), 128);
+    EXPECT_EQ(deque.steal(), 2);
+    EXPECT_EQ(deque.pop(), 99);
+
+    for (int n = 3; n < 99; ++n)
+    {
+        ASSERT_EQ(deque.steal(), n);
+    }
+
+    EXPECT_TRUE(deque.empty());
+}
+
+// Every element pushed by the owner is taken exactly once by either the
+// owner or one of the thieves, while the deque grows
+TEST(WorkStealingDequeTest, Test_3)
+{
+    constexpr int ELEMENTS_TOTAL = 200'000;
+    constexpr int THIEVES_TOTAL = 3;
+    WorkStealingDeque<int> deque(8);
+    std::vector<std::atomic<int>> takenCounts(ELEMENTS_TOTAL);
+    std::atomic<int> taken = 0;
+    std::vector<std::thread> thieves;
+
+    for (int n = 0; n < THIEVES_TOTAL; ++n)
+    {
+        thieves.emplace_back([&deque, &takenCounts, &taken]()
+        {
+            while (taken.load() < ELEMENTS_TOTAL)
+            {
+                if (auto value = deque.steal())
+                {
+                    ++takenCounts[*value];
+                    ++taken;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (int n = 0; n < ELEMENTS_TOTAL; ++n)
+    {
+        deque.push(n);
+
+        // Owner also consumes a part of its own work
+        if (n % 3 == 0)
+        {
+            if (auto value = deque.pop())
+            {
+                ++takenCounts[*value];
+                ++taken;
+            }
+        }
+    }
+
+    while (auto value = deque.pop())
+    {
+        ++takenCounts[*value];
+        ++taken;
+    }
+
+    for (auto& thief : thieves)
+    {
+        thief.join();
+    }
+
+    EXPECT_TRUE(deque.empty());
+
+    for (const auto& takenCount : takenCounts)
+    {
+        ASSERT_EQ(takenCount.load(), 1);
+    }
+}
+
+namespace
+{
+    /* Fork/join : each task of depth > 0 forks two tasks of depth - 1,
+       pushed into the deque of the worker running it, idle workers steal
+       from a random victim. Returns millions of tasks run per second */
+    double benchmarkForkJoin(size_t nbWorkers, int depth)
+    {
+        const long tasksTotal = (2L << depth) - 1;
+        std::vector<std::unique_ptr<WorkStealingDeque<int>>> deques;
+        std::atomic<long> tasksDone = 0;
+        std::vector<std::thread> workers;
+
+        for (size_t n = 0; n < nbWorkers; ++n)
+        {
+            deques.emplace_back(std::make_unique<WorkStealingDeque<int>>());
+        }
+
+        deques[0]->push(depth);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t n = 0; n < nbWorkers; ++n)
+        {
+            workers.emplace_back([&deques, &tasksDone, tasksTotal, n]()
+            {
+                auto& ownDeque = *deques[n];
+                std::minstd_rand random(static_cast<unsigned>(n));
+
+                while (tasksDone.load(std::memory_order_relaxed) < tasksTotal)
+                {
+                    std::optional<int> task = ownDeque.pop();
+
+                    if (!task)
+                    {
+                        task = deques[random() % deques.size()]->steal();
+                    }
+
+                    if (!task)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    if (*task > 0)
+                    {
+                        ownDeque.push(*task - 1);
+                        ownDeque.push(*task - 1);
+                    }
+
+                    tasksDone.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        return tasksTotal / elapsed.count();
+    }
+}
+
+// Benchmarks are disabled by default, run them with --gtest_also_run_disabled_tests
+TEST(WorkStealingDequeBenchmark, DISABLED_ForkJoin)
+{
+    size_t maxWorkers = std::max(2u, std::thread::hardware_concurrency());
+
+    for (size_t nbWorkers = 1; nbWorkers <= maxWorkers; nbWorkers *= 2)
+    {
+        std::cout << "workers=" << nbWorkers
+                  << " fork/join=" << benchmarkForkJoin(nbWorkers, 20)
+                  << "Mtasks/s" << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}